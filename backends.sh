@@ -0,0 +1,78 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# derive the backends used by the functions in args[] of config.h
+# usage: backends.sh header|cflags|libs [config.h]
+
+mode=$1
+config=${2:-config.h}
+
+# only picks backends, args[] entries name themselves through ARG()
+funcs=$(sed -n '/args\[\] *= *{/,/^};/{
+	s/^[[:space:]]*{[[:space:]]*\([a-z0-9_]*\).*/\1/p
+	s/^[[:space:]]*ARG([[:space:]]*\([a-z0-9_]*\).*/\1/p
+}' "$config")
+
+locals=
+buses=
+pkgs=
+for f in $funcs; do
+	case $f in
+	backlight_line) b=backlight; kind=local; pkg=libudev ;;
+	pa_*)           b=pa;        kind=local; pkg=libpulse ;;
+	keymap|keyboard_indicators)
+	                b=xkb;       kind=local; pkg= ;;
+	mm_*)           b=mm;        kind=bus;   pkg=mm-glib ;;
+	nm_*)           b=nm;        kind=bus;   pkg=libnm ;;
+	ppd_*)          b=ppd;       kind=bus;   pkg= ;;
+	upower_*)       b=upower;    kind=bus;   pkg=upower-glib ;;
+	*)              continue ;;
+	esac
+
+	case " $locals $buses " in
+	*" $b "*) continue ;;
+	esac
+
+	if [ "$kind" = bus ]; then
+		buses="$buses $b"
+		pkg="gio-2.0 $pkg"
+	else
+		locals="$locals $b"
+	fi
+
+	for p in $pkg; do
+		case " $pkgs " in
+		*" $p "*) ;;
+		*) pkgs="$pkgs $p" ;;
+		esac
+	done
+done
+
+list() {
+	for b in $1; do
+		printf ' X(%s)' "$b"
+	done
+}
+
+case $mode in
+header)
+	echo "/* generated by backends.sh from $config, do not edit */"
+	for b in $locals $buses; do
+		echo "#define USE_$(echo "$b" | tr a-z A-Z)"
+	done
+	case " $locals " in
+	*" backlight "*) echo "#define USE_UDEV" ;;
+	esac
+	[ -n "$buses" ] && echo "#define USE_BUS"
+	echo "#define LOCAL_BACKENDS(X)$(list "$locals")"
+	echo "#define BUS_BACKENDS(X)$(list "$buses")"
+	;;
+cflags|libs)
+	[ -z "$pkgs" ] || exec pkg-config --"$mode" $pkgs
+	;;
+*)
+	echo "usage: $0 header|cflags|libs [config.h]" >&2
+	exit 1
+	;;
+esac
+exit 0
@@ -0,0 +1,143 @@
+/* See LICENSE file for copyright and license details. */
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+
+#include "bus.h"
+#include "slstatus.h"
+#include "util.h"
+
+/* taken by the renderer even when no backend needs the bus */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+void
+bus_lock(void)
+{
+	pthread_mutex_lock(&lock);
+}
+
+void
+bus_unlock(void)
+{
+	pthread_mutex_unlock(&lock);
+}
+
+#ifdef USE_BUS
+#include <gio/gio.h>
+
+GMainContext *bus_context;
+GDBusConnection *bus_conn;
+
+static pthread_t thread;
+static volatile int running;
+static void (*attach)(void);
+
+static void *
+loop(void *arg)
+{
+	GPollFD *fds;
+	sigset_t set;
+	gint prio, timeout, n, nfds = 16;
+
+	/* signals are for the renderer, which sleeps on them */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	if (!g_main_context_acquire(bus_context))
+		die("g_main_context_acquire: context owned by another thread");
+	/* async calls the backends start from callbacks complete here too */
+	g_main_context_push_thread_default(bus_context);
+
+	fds = g_new(GPollFD, nfds);
+	while (running) {
+		g_main_context_prepare(bus_context, &prio);
+		while ((n = g_main_context_query(bus_context, prio, &timeout,
+		                                 fds, nfds)) > nfds) {
+			nfds = n;
+			fds = g_renew(GPollFD, fds, nfds);
+		}
+
+		g_poll(fds, n, timeout);
+
+		pthread_mutex_lock(&lock);
+		if (g_main_context_check(bus_context, prio, fds, n))
+			g_main_context_dispatch(bus_context);
+		pthread_mutex_unlock(&lock);
+	}
+	g_free(fds);
+
+	g_main_context_pop_thread_default(bus_context);
+	g_main_context_release(bus_context);
+
+	return NULL;
+}
+
+static void
+bus_get_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GError *error = NULL;
+
+	if (!(bus_conn = g_bus_get_finish(res, &error))) {
+		warn("g_bus_get: %s", error->message);
+		g_clear_error(&error);
+	}
+
+	/* also without a connection, the backends report themselves unavailable */
+	attach();
+}
+
+/*
+ * cb creates the backends once the system bus is connected, on the bus
+ * thread; a slow or missing bus does not hold up the first status
+ */
+void
+bus_init(void (*cb)(void))
+{
+	attach = cb;
+	bus_context = g_main_context_new();
+	g_main_context_push_thread_default(bus_context);
+
+	g_bus_get(G_BUS_TYPE_SYSTEM, NULL, bus_get_callback, NULL);
+}
+
+void
+bus_start(void)
+{
+	int err;
+
+	g_main_context_pop_thread_default(bus_context);
+
+	running = 1;
+	if ((err = pthread_create(&thread, NULL, loop, NULL))) {
+		running = 0;
+		warn("pthread_create: %s", strerror(err));
+	}
+}
+
+/* no callbacks run after this, the connection stays for the backends' _free() */
+void
+bus_stop(void)
+{
+	if (running) {
+		running = 0;
+		g_main_context_wakeup(bus_context);
+		pthread_join(thread, NULL);
+	}
+}
+
+void
+bus_free(void)
+{
+	bus_stop();
+
+	if (bus_conn) {
+		g_object_unref(bus_conn);
+		bus_conn = NULL;
+	}
+
+	if (bus_context) {
+		g_main_context_unref(bus_context);
+		bus_context = NULL;
+	}
+}
+#endif
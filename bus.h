@@ -0,0 +1,16 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * GLib main context shared by all D-Bus backends and dispatched on its
+ * own thread. Backend callbacks run with the bus lock held; the renderer
+ * takes it while sampling segments.
+ */
+extern struct _GMainContext *bus_context;
+extern struct _GDBusConnection *bus_conn;
+
+void bus_init(void (*cb)(void));
+void bus_start(void);
+void bus_stop(void);
+void bus_lock(void);
+void bus_unlock(void);
+void bus_free(void);
@@ -1,33 +1,48 @@
 /* See LICENSE file for copyright and license details. */
-#include <fcntl.h>
-#include <libudev.h>
 #include <limits.h>
-#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-#include "../queue.h"
 #include "../slstatus.h"
 #include "../util.h"
 
+/* brightness steps of the backlight icons */
+static const int backlight_levels[] = { 25, 50, 75 };
+static const char *backlight_icons[] = { "󰃞", "󰃟", "󰃝", "󰃠" };
+
+#ifdef USE_BACKLIGHT
+#include <libudev.h>
+
+#include "../registry.h"
+#include "../uevent.h"
+
 #define BACKLIGHT_PATH "/sys/class/backlight/%s"
 
 typedef struct backlight_t {
-	TAILQ_ENTRY(backlight_t) entry;
 	const char *name;
 	int brightness;
-	struct udev_monitor *monitor;
+	int max_brightness;
 } backlight_t;
 
-TAILQ_HEAD(backlight_q, backlight_t);
+struct registry backlight_registry;
+unsigned int backlight_gen = 1;
+
+/* percentage of the cached maximum, -1 if unreadable */
+static int
+backlight_read(backlight_t *backlight, struct udev_device *device)
+{
+	const char *val;
 
-struct backlight_q backlight_queue;
-struct udev *udev = NULL;
-struct udev_monitor *udev_monitor = NULL;
-pthread_t backlight_thread;
+	if (backlight->max_brightness <= 0)
+		return -1;
+	if (!(val = udev_device_get_sysattr_value(device, "brightness")))
+		return -1;
+
+	return (int)(100.0 * atoi(val) / backlight->max_brightness);
+}
 
 backlight_t *
 backlight_find(const char *name, int create)
@@ -35,187 +50,168 @@ backlight_find(const char *name, int create)
 	backlight_t *backlight;
 	char path[PATH_MAX];
 	struct udev_device *device;
+	const char *max;
+	uintptr_t key;
+	void *val;
 
-	TAILQ_FOREACH(backlight, &backlight_queue, entry)
-		if (!strcmp(backlight->name, name)) {
-			return backlight;
-		}
+	key = REG_KEY(name);
+	if (reg_get(&backlight_registry, key, &val))
+		return val;
 
-	if (!create)
+	if (!create || !uevent_udev)
 		return NULL;
-	
+
 	if (esnprintf(path, sizeof(path), BACKLIGHT_PATH, name) < 0)
 		return NULL;
 
-	device = udev_device_new_from_syspath(udev, path);
-	if (!device)
+	device = udev_device_new_from_syspath(uevent_udev, path);
+	if (!device) {
+		reg_put(&backlight_registry, key, NULL);
 		return NULL;
+	}
 
-	backlight = calloc(1, sizeof(backlight_t));
-	backlight->name = strdup(name);
-	backlight->brightness = (int)(100.0 * (float)atoi(udev_device_get_sysattr_value(device, "brightness")) / atoi(udev_device_get_sysattr_value(device, "max_brightness")));
+	if (!(backlight = calloc(1, sizeof(backlight_t))))
+		die("calloc:");
+	backlight->name = intern(name);
+	/* fixed by the driver, read it once */
+	if ((max = udev_device_get_sysattr_value(device, "max_brightness")))
+		backlight->max_brightness = atoi(max);
+	backlight->brightness = backlight_read(backlight, device);
+	udev_device_unref(device);
 
-	TAILQ_INSERT_TAIL(&backlight_queue, backlight, entry);
+	reg_put(&backlight_registry, key, backlight);
 
 	return backlight;
 }
 
-void *
-backlight_loop(void *arg)
+static backlight_t *
+backlight_bind(struct seg *s, const char *name)
 {
-	backlight_t *backlight;
-	const char *name;
-	int brightness, fd, flags;
-	struct udev_device *device;
-
-	udev_monitor = udev_monitor_new_from_netlink(udev, "udev");
-	udev_monitor_filter_add_match_subsystem_devtype(udev_monitor, "backlight", NULL);
-	udev_monitor_enable_receiving(udev_monitor);
-
-	fd = udev_monitor_get_fd(udev_monitor);
-	flags = fcntl(fd, F_GETFL);
-	fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
-
-	while (1) {
-		device = udev_monitor_receive_device(udev_monitor);
-		if (device) {
-			name = udev_device_get_sysname(device);
-			backlight = backlight_find(name, 0);
-			if (backlight) {
-				brightness = (int)(100.0 * (float)atoi(udev_device_get_sysattr_value(device, "brightness")) / atoi(udev_device_get_sysattr_value(device, "max_brightness")));
-				if (brightness != backlight->brightness) {
-					backlight->brightness = brightness;
-					kill(getpid(), SIGRTMIN + BACKLIGHT_SIGNAL);
-				}
-			}
-			udev_device_unref(device);
-		}
+	if (!s->handle && s->gen != backlight_gen) {
+		s->gen = backlight_gen;
+		s->handle = backlight_find(name, 1);
 	}
 
-	return NULL;
+	return s->handle;
 }
 
-void
-backlight_init(void)
+static void
+backlight_uevent(struct udev_device *device, void *arg)
 {
+	backlight_t *backlight;
+	const char *action;
+	int brightness;
 
-	udev = udev_new();
-	if (!udev)
-		return;
+	action = udev_device_get_action(device);
+	if (action && !strcmp(action, "add")) {
+		reg_purge(&backlight_registry);
+		backlight_gen++;
+	}
 
-	TAILQ_INIT(&backlight_queue);
+	backlight = backlight_find(udev_device_get_sysname(device), 0);
+	if (!backlight)
+		return;
 
-	pthread_create(&backlight_thread, NULL, backlight_loop, NULL);
+	brightness = backlight_read(backlight, device);
+	if (brightness != backlight->brightness) {
+		backlight->brightness = brightness;
+		kill(getpid(), SIGRTMIN + BACKLIGHT_SIGNAL);
+	}
 }
 
 void
-backlight_tick(void)
+backlight_init(void)
 {
+	trace("backlight", uevent_udev != NULL);
+	uevent_add("backlight", backlight_uevent, NULL);
 }
 
 void
 backlight_free(void)
 {
-	pthread_kill(backlight_thread, SIGTERM);
-
-	if (udev_monitor) {
-		udev_monitor_unref(udev_monitor);
-		udev_monitor = NULL;
-	}
+	size_t iter = 0;
+	void *val;
 
-	if (udev) {
-		udev_unref(udev);
-		udev = NULL;
-	}
+	while (reg_next(&backlight_registry, &iter, &val))
+		free(val);
+	reg_free(&backlight_registry);
 }
 
 const char *
-backlight_line(const char *arg)
+backlight_line(struct seg *s, const char *arg)
 {
-	/*
-	char *icon;
-	const char *str_perc;
-	unsigned long perc;
-
-	if (!(str_perc = backlight_perc(arg)))
-		return NULL;
-
-	perc = strtoul(str_perc, NULL, 10);
-
-	if (perc < 25)
-		icon = "󰃞";
-	else if (perc < 50)
-		icon = "󰃟";
-	else if (perc < 75)
-		icon = "󰃝";
-	else
-		icon = "󰃠";
-
-	return bprintf("%s %d%%", icon, perc);
-	*/
 	backlight_t *backlight;
-	char *icon;
 
-	backlight = backlight_find(arg, 1);
-	if (!backlight)
+	backlight = backlight_bind(s, arg);
+	if (!backlight || backlight->brightness < 0)
 		return NULL;
 
-	if (backlight->brightness < 25)
-		icon = "󰃞";
-	else if (backlight->brightness < 50)
-		icon = "󰃟";
-	else if (backlight->brightness < 75)
-		icon = "󰃝";
-	else
-		icon = "󰃠";
-
-	return bprintf("%s %d%%", icon, backlight->brightness);
+	return vicon(s, backlight_icons[qlevel(backlight_levels,
+	             LEN(backlight_levels), backlight->brightness)],
+	             backlight->brightness);
 }
 
+#endif
+
 const char *
-backlight_icon(const char *arg)
+backlight_icon(struct seg *s, const char *arg)
 {
-	unsigned long perc;
-	const char *str_perc;
-
-	if (!(str_perc = backlight_perc(arg)))
+	if (!backlight_perc(s, arg))
 		return NULL;
 
-	perc = strtoul(str_perc, NULL, 10);
-
-	if (perc < 25)
-		return "󰃞";
-	else if (perc < 50)
-		return "󰃟";
-	else if (perc < 75)
-		return "󰃝";
-	else
-		return "󰃠";
+	/* the number behind the text, nothing to parse */
+	return backlight_icons[qlevel(backlight_levels, LEN(backlight_levels),
+	                              s->val.num)];
 }
 
 #if defined(__linux__)
-	#include <limits.h>
-
 	#define BACKLIGHT_BRIGHTNESS "/sys/class/backlight/%s/brightness"
 	#define BACKLIGHT_MAX_BRIGHTNESS "/sys/class/backlight/%s/max_brightness"
 
+	struct backlight_files {
+		struct pfile *brightness;
+		int max_brightness;
+	};
+
+	static void
+	backlight_files_unbind(void *p)
+	{
+		struct backlight_files *b = p;
+
+		pfclose(b->brightness);
+		free(b);
+	}
+
 	const char *
-	backlight_perc(const char *arg)
+	backlight_perc(struct seg *s, const char *arg)
 	{
-		int brightness, max_brightness;
+		struct backlight_files *b;
 		char path[PATH_MAX];
-	
-		if (esnprintf(path, sizeof(path), BACKLIGHT_BRIGHTNESS, arg) < 0)
-			return NULL;
-		if (pscanf(path, "%d", &brightness) != 1)
-			return NULL;
-	
-		if (esnprintf(path, sizeof(path), BACKLIGHT_MAX_BRIGHTNESS, arg) < 0)
-			return NULL;
-		if (pscanf(path, "%d", &max_brightness) != 1)
+		int brightness;
+
+		if (!(b = s->handle)) {
+			if (!(b = malloc(sizeof(*b))))
+				die("malloc:");
+			b->brightness = pfopen(BACKLIGHT_BRIGHTNESS, arg);
+			b->max_brightness = 0;
+			s->handle = b;
+			s->unbind = backlight_files_unbind;
+		}
+
+		/* fixed by the driver, read it once */
+		if (b->max_brightness <= 0) {
+			if (esnprintf(path, sizeof(path), BACKLIGHT_MAX_BRIGHTNESS, arg) < 0)
+				return NULL;
+			if (pscanf(path, "%d", &b->max_brightness) != 1 ||
+			    b->max_brightness <= 0) {
+				b->max_brightness = 0;
+				return NULL;
+			}
+		}
+
+		if (pfscanf(b->brightness, "%d", &brightness) != 1)
 			return NULL;
-	
-		 return bprintf("%d", (int)(100 * (double)brightness / max_brightness));
+
+		return vnum(s, VAL_PERC, (int)(100 * (double)brightness / b->max_brightness));
 	}
 #endif
-
@@ -9,9 +9,8 @@
 /*
  * https://www.kernel.org/doc/html/latest/power/power_supply_class.html
  */
-	#include <limits.h>
 	#include <stdint.h>
-	#include <unistd.h>
+	#include <stdlib.h>
 
 	#define POWER_SUPPLY_CAPACITY "/sys/class/power_supply/%s/capacity"
 	#define POWER_SUPPLY_STATUS   "/sys/class/power_supply/%s/status"
@@ -20,37 +19,69 @@
 	#define POWER_SUPPLY_CURRENT  "/sys/class/power_supply/%s/current_now"
 	#define POWER_SUPPLY_POWER    "/sys/class/power_supply/%s/power_now"
 
-	static const char *
-	pick(const char *bat, const char *f1, const char *f2, char *path,
-	     size_t length)
+	struct battery {
+		struct pfile *status;
+		struct pfile *charge;
+		struct pfile *current;
+	};
+
+	static struct pfile *
+	pick(const char *bat, const char *f1, const char *f2)
 	{
-		if (esnprintf(path, length, f1, bat) > 0 &&
-		    access(path, R_OK) == 0)
-			return f1;
+		struct pfile *f;
 
-		if (esnprintf(path, length, f2, bat) > 0 &&
-		    access(path, R_OK) == 0)
-			return f2;
+		if ((f = pfopen(f1, bat)) && f->fd >= 0)
+			return f;
+		pfclose(f);
 
-		return NULL;
+		return pfopen(f2, bat);
+	}
+
+	static void
+	battery_unbind(void *p)
+	{
+		struct battery *b = p;
+
+		pfclose(b->status);
+		pfclose(b->charge);
+		pfclose(b->current);
+		free(b);
+	}
+
+	static struct battery *
+	battery_bind(struct seg *s, const char *bat)
+	{
+		struct battery *b;
+
+		if (s->handle)
+			return s->handle;
+
+		if (!(b = malloc(sizeof(*b))))
+			die("malloc:");
+		b->status = pfopen(POWER_SUPPLY_STATUS, bat);
+		b->charge = pick(bat, POWER_SUPPLY_CHARGE, POWER_SUPPLY_ENERGY);
+		b->current = pick(bat, POWER_SUPPLY_CURRENT, POWER_SUPPLY_POWER);
+
+		s->handle = b;
+		s->unbind = battery_unbind;
+
+		return b;
 	}
 
 	const char *
-	battery_perc(const char *bat)
+	battery_perc(struct seg *s, const char *bat)
 	{
 		int cap_perc;
-		char path[PATH_MAX];
 
-		if (esnprintf(path, sizeof(path), POWER_SUPPLY_CAPACITY, bat) < 0)
-			return NULL;
-		if (pscanf(path, "%d", &cap_perc) != 1)
+		if (pfscanf(segfile(s, POWER_SUPPLY_CAPACITY, bat), "%d",
+		            &cap_perc) != 1)
 			return NULL;
 
-		return bprintf("%d", cap_perc);
+		return vnum(s, VAL_PERC, cap_perc);
 	}
 
 	const char *
-	battery_state(const char *bat)
+	battery_state(struct seg *s, const char *bat)
 	{
 		static struct {
 			char *state;
@@ -62,11 +93,10 @@
 			{ "Not charging", "o" },
 		};
 		size_t i;
-		char path[PATH_MAX], state[12];
+		char state[13];
 
-		if (esnprintf(path, sizeof(path), POWER_SUPPLY_STATUS, bat) < 0)
-			return NULL;
-		if (pscanf(path, "%12[a-zA-Z ]", state) != 1)
+		if (pfscanf(segfile(s, POWER_SUPPLY_STATUS, bat), "%12[a-zA-Z ]",
+		            state) != 1)
 			return NULL;
 
 		for (i = 0; i < LEN(map); i++)
@@ -77,36 +107,32 @@
 	}
 
 	const char *
-	battery_remaining(const char *bat)
+	battery_remaining(struct seg *s, const char *bat)
 	{
-		uintmax_t charge_now, current_now, m, h;
+		struct battery *b;
+		uintmax_t charge_now, current_now;
 		double timeleft;
-		char path[PATH_MAX], state[12];
+		char state[13];
 
-		if (esnprintf(path, sizeof(path), POWER_SUPPLY_STATUS, bat) < 0)
-			return NULL;
-		if (pscanf(path, "%12[a-zA-Z ]", state) != 1)
+		b = battery_bind(s, bat);
+
+		if (pfscanf(b->status, "%12[a-zA-Z ]", state) != 1)
 			return NULL;
 
-		if (!pick(bat, POWER_SUPPLY_CHARGE, POWER_SUPPLY_ENERGY, path,
-		          sizeof(path)) ||
-		    pscanf(path, "%ju", &charge_now) < 0)
+		if (pfscanf(b->charge, "%ju", &charge_now) < 0)
 			return NULL;
 
 		if (!strcmp(state, "Discharging")) {
-			if (!pick(bat, POWER_SUPPLY_CURRENT, POWER_SUPPLY_POWER, path,
-			          sizeof(path)) ||
-			    pscanf(path, "%ju", &current_now) < 0)
+			if (pfscanf(b->current, "%ju", &current_now) < 0)
 				return NULL;
 
 			if (current_now == 0)
 				return NULL;
 
+			/* in hours, shown to the minute */
 			timeleft = (double)charge_now / (double)current_now;
-			h = timeleft;
-			m = (timeleft - (double)h) * 60;
 
-			return bprintf("%juh %jum", h, m);
+			return vnum(s, VAL_SECS, (intmax_t)(timeleft * 60) * 60);
 		}
 
 		return "";
@@ -138,18 +164,18 @@
 	}
 
 	const char *
-	battery_perc(const char *unused)
+	battery_perc(struct seg *s, const char *unused)
 	{
 		struct apm_power_info apm_info;
 
 		if (load_apm_power_info(&apm_info))
-			return bprintf("%d", apm_info.battery_life);
+			return bprintf(s, "%d", apm_info.battery_life);
 
 		return NULL;
 	}
 
 	const char *
-	battery_state(const char *unused)
+	battery_state(struct seg *s, const char *unused)
 	{
 		struct {
 			unsigned int state;
@@ -173,7 +199,7 @@
 	}
 
 	const char *
-	battery_remaining(const char *unused)
+	battery_remaining(struct seg *s, const char *unused)
 	{
 		struct apm_power_info apm_info;
 		unsigned int h, m;
@@ -182,7 +208,7 @@
 			if (apm_info.ac_state != APM_AC_ON) {
 				h = apm_info.minutes_left / 60;
 				m = apm_info.minutes_left % 60;
-				return bprintf("%uh %02um", h, m);
+				return bprintf(s, "%uh %02um", h, m);
 			} else {
 				return "";
 			}
@@ -198,7 +224,7 @@
 	#define BATTERY_TIME  "hw.acpi.battery.time"
 
 	const char *
-	battery_perc(const char *unused)
+	battery_perc(struct seg *s, const char *unused)
 	{
 		int cap_perc;
 		size_t len;
@@ -207,11 +233,11 @@
 		if (sysctlbyname(BATTERY_LIFE, &cap_perc, &len, NULL, 0) < 0 || !len)
 			return NULL;
 
-		return bprintf("%d", cap_perc);
+		return bprintf(s, "%d", cap_perc);
 	}
 
 	const char *
-	battery_state(const char *unused)
+	battery_state(struct seg *s, const char *unused)
 	{
 		int state;
 		size_t len;
@@ -232,7 +258,7 @@
 	}
 
 	const char *
-	battery_remaining(const char *unused)
+	battery_remaining(struct seg *s, const char *unused)
 	{
 		int rem;
 		size_t len;
@@ -242,6 +268,6 @@
 		    || rem < 0)
 			return NULL;
 
-		return bprintf("%uh %02um", rem / 60, rem % 60);
+		return bprintf(s, "%uh %02um", rem / 60, rem % 60);
 	}
 #endif
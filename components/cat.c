@@ -6,7 +6,7 @@
 #include "../util.h"
 
 const char *
-cat(const char *path)
+cat(struct seg *s, const char *path)
 {
         char *f;
         FILE *fp;
@@ -16,7 +16,7 @@ cat(const char *path)
                 return NULL;
         }
 
-        f = fgets(buf, sizeof(buf) - 1, fp);
+        f = fgets(s->buf, s->size, fp);
         if (fclose(fp) < 0) {
                 warn("fclose '%s':", path);
                 return NULL;
@@ -24,9 +24,9 @@ cat(const char *path)
         if (!f)
                 return NULL;
 
-        if ((f = strrchr(buf, '\n')))
+        if ((f = strrchr(s->buf, '\n')))
                 f[0] = '\0';
 
-        return buf[0] ? buf : NULL;
+        return s->buf[0] ? s->buf : NULL;
 }
 
@@ -7,30 +7,56 @@
 #include "../util.h"
 
 #if defined(__linux__)
+	#include <stdlib.h>
+
 	#define CPU_FREQ "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq"
+	#define CPU_STAT "/proc/stat"
+
+	struct cpu {
+		struct pfile *file;
+		long double a[7];
+	};
+
+	static void
+	cpu_unbind(void *p)
+	{
+		struct cpu *c = p;
+
+		pfclose(c->file);
+		free(c);
+	}
 
 	const char *
-	cpu_freq(const char *unused)
+	cpu_freq(struct seg *s, const char *unused)
 	{
 		uintmax_t freq;
 
 		/* in kHz */
-		if (pscanf(CPU_FREQ, "%ju", &freq) != 1)
+		if (pfscanf(segfile(s, CPU_FREQ, NULL), "%ju", &freq) != 1)
 			return NULL;
 
-		return fmt_human(freq * 1000, 1000);
+		return vnum(s, VAL_SI, freq * 1000);
 	}
 
 	const char *
-	cpu_perc(const char *unused)
+	cpu_perc(struct seg *s, const char *unused)
 	{
-		static long double a[7];
-		long double b[7], sum;
+		struct cpu *c;
+		long double *a, b[7], sum;
+
+		if (!(c = s->handle)) {
+			if (!(c = calloc(1, sizeof(*c))))
+				die("calloc:");
+			c->file = pfopen(CPU_STAT, NULL);
+			s->handle = c;
+			s->unbind = cpu_unbind;
+		}
+		a = c->a;
 
 		memcpy(b, a, sizeof(b));
 		/* cpu user nice system idle iowait irq softirq */
-		if (pscanf("/proc/stat", "%*s %Lf %Lf %Lf %Lf %Lf %Lf %Lf",
-		           &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6])
+		if (pfscanf(c->file, "%*s %Lf %Lf %Lf %Lf %Lf %Lf %Lf",
+		            &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6])
 		    != 7)
 			return NULL;
 
@@ -43,9 +69,9 @@
 		if (sum == 0)
 			return NULL;
 
-		return bprintf("%d", (int)(100 *
-		               ((b[0] + b[1] + b[2] + b[5] + b[6]) -
-		                (a[0] + a[1] + a[2] + a[5] + a[6])) / sum));
+		return vnum(s, VAL_PERC, (int)(100 *
+		                   ((b[0] + b[1] + b[2] + b[5] + b[6]) -
+		                    (a[0] + a[1] + a[2] + a[5] + a[6])) / sum));
 	}
 #elif defined(__OpenBSD__)
 	#include <sys/param.h>
@@ -53,7 +79,7 @@
 	#include <sys/sysctl.h>
 
 	const char *
-	cpu_freq(const char *unused)
+	cpu_freq(struct seg *s, const char *unused)
 	{
 		int freq, mib[2];
 		size_t size;
@@ -69,11 +95,11 @@
 			return NULL;
 		}
 
-		return fmt_human(freq * 1E6, 1000);
+		return vnum(s, VAL_SI, freq * 1E6);
 	}
 
 	const char *
-	cpu_perc(const char *unused)
+	cpu_perc(struct seg *s, const char *unused)
 	{
 		int mib[2];
 		static uintmax_t a[CPUSTATES];
@@ -99,11 +125,11 @@
 		if (sum == 0)
 			return NULL;
 
-		return bprintf("%d", 100 *
-		               ((a[CP_USER] + a[CP_NICE] + a[CP_SYS] +
-		                 a[CP_INTR]) -
-		                (b[CP_USER] + b[CP_NICE] + b[CP_SYS] +
-		                 b[CP_INTR])) / sum);
+		return vnum(s, VAL_PERC, 100 *
+		                   ((a[CP_USER] + a[CP_NICE] + a[CP_SYS] +
+		                     a[CP_INTR]) -
+		                    (b[CP_USER] + b[CP_NICE] + b[CP_SYS] +
+		                     b[CP_INTR])) / sum);
 	}
 #elif defined(__FreeBSD__)
 	#include <devstat.h>
@@ -111,7 +137,7 @@
 	#include <sys/sysctl.h>
 
 	const char *
-	cpu_freq(const char *unused)
+	cpu_freq(struct seg *s, const char *unused)
 	{
 		int freq;
 		size_t size;
@@ -123,11 +149,11 @@
 			return NULL;
 		}
 
-		return fmt_human(freq * 1E6, 1000);
+		return vnum(s, VAL_SI, freq * 1E6);
 	}
 
 	const char *
-	cpu_perc(const char *unused)
+	cpu_perc(struct seg *s, const char *unused)
 	{
 		size_t size;
 		static long a[CPUSTATES];
@@ -148,10 +174,10 @@
 		if (sum == 0)
 			return NULL;
 
-		return bprintf("%d", 100 *
-		               ((a[CP_USER] + a[CP_NICE] + a[CP_SYS] +
-		                 a[CP_INTR]) -
-		                (b[CP_USER] + b[CP_NICE] + b[CP_SYS] +
-		                 b[CP_INTR])) / sum);
+		return vnum(s, VAL_PERC, 100 *
+		                   ((a[CP_USER] + a[CP_NICE] + a[CP_SYS] +
+		                     a[CP_INTR]) -
+		                    (b[CP_USER] + b[CP_NICE] + b[CP_SYS] +
+		                     b[CP_INTR])) / sum);
 	}
 #endif
@@ -6,15 +6,15 @@
 #include "../util.h"
 
 const char *
-datetime(const char *fmt)
+datetime(struct seg *s, const char *fmt)
 {
 	time_t t;
 
 	t = time(NULL);
-	if (!strftime(buf, sizeof(buf), fmt, localtime(&t))) {
+	if (!strftime(s->buf, s->size, fmt, localtime(&t))) {
 		warn("strftime: Result string exceeds buffer size");
 		return NULL;
 	}
 
-	return buf;
+	return s->buf;
 }
@@ -6,7 +6,7 @@
 #include "../util.h"
 
 const char *
-disk_free(const char *path)
+disk_free(struct seg *s, const char *path)
 {
 	struct statvfs fs;
 
@@ -15,11 +15,11 @@ disk_free(const char *path)
 		return NULL;
 	}
 
-	return fmt_human(fs.f_frsize * fs.f_bavail, 1024);
+	return vnum(s, VAL_BYTES, fs.f_frsize * fs.f_bavail);
 }
 
 const char *
-disk_perc(const char *path)
+disk_perc(struct seg *s, const char *path)
 {
 	struct statvfs fs;
 
@@ -28,12 +28,12 @@ disk_perc(const char *path)
 		return NULL;
 	}
 
-	return bprintf("%d", (int)(100 *
-	               (1 - ((double)fs.f_bavail / (double)fs.f_blocks))));
+	return vnum(s, VAL_PERC, (int)(100 *
+	                   (1 - ((double)fs.f_bavail / (double)fs.f_blocks))));
 }
 
 const char *
-disk_total(const char *path)
+disk_total(struct seg *s, const char *path)
 {
 	struct statvfs fs;
 
@@ -42,11 +42,11 @@ disk_total(const char *path)
 		return NULL;
 	}
 
-	return fmt_human(fs.f_frsize * fs.f_blocks, 1024);
+	return vnum(s, VAL_BYTES, fs.f_frsize * fs.f_blocks);
 }
 
 const char *
-disk_used(const char *path)
+disk_used(struct seg *s, const char *path)
 {
 	struct statvfs fs;
 
@@ -55,5 +55,5 @@ disk_used(const char *path)
 		return NULL;
 	}
 
-	return fmt_human(fs.f_frsize * (fs.f_blocks - fs.f_bfree), 1024);
+	return vnum(s, VAL_BYTES, fs.f_frsize * (fs.f_blocks - fs.f_bfree));
 }
@@ -9,18 +9,18 @@
 	#define ENTROPY_AVAIL "/proc/sys/kernel/random/entropy_avail"
 
 	const char *
-	entropy(const char *unused)
+	entropy(struct seg *s, const char *unused)
 	{
 		uintmax_t num;
 
-		if (pscanf(ENTROPY_AVAIL, "%ju", &num) != 1)
+		if (pfscanf(segfile(s, ENTROPY_AVAIL, NULL), "%ju", &num) != 1)
 			return NULL;
 
-		return bprintf("%ju", num);
+		return vnum(s, VAL_INT, num);
 	}
 #elif defined(__OpenBSD__) | defined(__FreeBSD__)
 	const char *
-	entropy(const char *unused)
+	entropy(struct seg *s, const char *unused)
 	{
 		// https://www.unicode.org/charts/PDF/U2200.pdf
 		/* Unicode Character 'INFINITY' (U+221E) */
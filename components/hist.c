@@ -0,0 +1,89 @@
+/* See LICENSE file for copyright and license details. */
+#include <string.h>
+
+#include "../ring.h"
+#include "../slstatus.h"
+#include "../util.h"
+
+/* ring of the segment at args[] index arg, looked up once */
+static struct ring *
+hist_bind(struct seg *s, const char *arg)
+{
+	long i;
+
+	if (!s->handle && !s->gen) {
+		s->gen = 1;
+		if ((i = ring_index(arg)) < 0)
+			warn("hist: '%s': Not an args[] index", arg ? arg : "");
+		else
+			s->handle = ring_get(i);
+	}
+
+	return s->handle;
+}
+
+/*
+ * one block per sample, from oldest to newest, as many as fit; percents
+ * span 0 to 100, anything else the window minimum to maximum
+ */
+const char *
+hist_spark(struct seg *s, const char *arg)
+{
+	static const char *blocks[] = {
+		"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"
+	};
+	struct ring *r;
+	intmax_t lo, hi, v;
+	size_t k, n, i;
+	int b;
+
+	if (!(r = hist_bind(s, arg)) || !r->len)
+		return NULL;
+
+	lo = (r->type == VAL_PERC) ? 0 : ring_min(r);
+	hi = (r->type == VAL_PERC) ? 100 : ring_max(r);
+	n = (s->size - 1) / strlen(blocks[0]);
+	k = (r->len > n) ? r->len - n : 0;
+
+	for (i = 0; k < r->len; k++) {
+		v = ring_at(r, k);
+		b = (hi > lo) ? (v - lo) * (int)(LEN(blocks) - 1) / (hi - lo) : 0;
+		if (b < 0)
+			b = 0;
+		else if (b >= (int)LEN(blocks))
+			b = LEN(blocks) - 1;
+		memcpy(s->buf + i, blocks[b], strlen(blocks[b]));
+		i += strlen(blocks[b]);
+	}
+	s->buf[i] = '\0';
+
+	return s->buf;
+}
+
+const char *
+hist_min(struct seg *s, const char *arg)
+{
+	struct ring *r = hist_bind(s, arg);
+	return (r && r->len) ? vnum(s, r->type, ring_min(r)) : NULL;
+}
+
+const char *
+hist_max(struct seg *s, const char *arg)
+{
+	struct ring *r = hist_bind(s, arg);
+	return (r && r->len) ? vnum(s, r->type, ring_max(r)) : NULL;
+}
+
+const char *
+hist_avg(struct seg *s, const char *arg)
+{
+	struct ring *r = hist_bind(s, arg);
+	return (r && r->len) ? vnum(s, r->type, ring_avg(r)) : NULL;
+}
+
+const char *
+hist_p95(struct seg *s, const char *arg)
+{
+	struct ring *r = hist_bind(s, arg);
+	return (r && r->len) ? vnum(s, r->type, ring_pct(r, 95)) : NULL;
+}
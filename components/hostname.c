@@ -6,12 +6,12 @@
 #include "../util.h"
 
 const char *
-hostname(const char *unused)
+hostname(struct seg *s, const char *unused)
 {
-	if (gethostname(buf, sizeof(buf)) < 0) {
+	if (gethostname(s->buf, s->size) < 0) {
 		warn("gethostbyname:");
 		return NULL;
 	}
 
-	return buf;
+	return s->buf;
 }
@@ -16,7 +16,7 @@
 #include "../util.h"
 
 static const char *
-ip(const char *interface, unsigned short sa_family)
+ip(struct seg *seg, const char *interface, unsigned short sa_family)
 {
 	struct ifaddrs *ifaddr, *ifa;
 	int s;
@@ -40,7 +40,7 @@ ip(const char *interface, unsigned short sa_family)
 				warn("getnameinfo: %s", gai_strerror(s));
 				return NULL;
 			}
-			return bprintf("%s", host);
+			return bprintf(seg, "%s", host);
 		}
 	}
 
@@ -50,19 +50,19 @@ ip(const char *interface, unsigned short sa_family)
 }
 
 const char *
-ipv4(const char *interface)
+ipv4(struct seg *s, const char *interface)
 {
-	return ip(interface, AF_INET);
+	return ip(s, interface, AF_INET);
 }
 
 const char *
-ipv6(const char *interface)
+ipv6(struct seg *s, const char *interface)
 {
-	return ip(interface, AF_INET6);
+	return ip(s, interface, AF_INET6);
 }
 
 const char *
-up(const char *interface)
+up(struct seg *s, const char *interface)
 {
 	struct ifaddrs *ifaddr, *ifa;
 
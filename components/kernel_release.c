@@ -6,7 +6,7 @@
 #include "../util.h"
 
 const char *
-kernel_release(const char *unused)
+kernel_release(struct seg *s, const char *unused)
 {
 	struct utsname udata;
 
@@ -15,5 +15,5 @@ kernel_release(const char *unused)
 		return NULL;
 	}
 
-	return bprintf("%s", udata.release);
+	return bprintf(s, "%s", udata.release);
 }
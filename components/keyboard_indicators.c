@@ -1,10 +1,10 @@
 /* See LICENSE file for copyright and license details. */
+#include "../slstatus.h"
+
+#ifdef USE_XKB
 #include <ctype.h>
-#include <stdio.h>
 #include <string.h>
-#include <X11/Xlib.h>
 
-#include "../slstatus.h"
 #include "../util.h"
 
 /*
@@ -15,20 +15,14 @@
  * included, lowercase when off and uppercase when on.
  */
 const char *
-keyboard_indicators(const char *fmt)
+keyboard_indicators(struct seg *s, const char *fmt)
 {
-	Display *dpy;
-	XKeyboardState state;
 	size_t fmtlen, i, n;
 	int togglecase, isset;
 	char key;
 
-	if (!(dpy = XOpenDisplay(NULL))) {
-		warn("XOpenDisplay: Failed to open display");
+	if (!xkb_ready)
 		return NULL;
-	}
-	XGetKeyboardControl(dpy, &state);
-	XCloseDisplay(dpy);
 
 	fmtlen = strnlen(fmt, 4);
 	for (i = n = 0; i < fmtlen; i++) {
@@ -37,14 +31,15 @@ keyboard_indicators(const char *fmt)
 			continue;
 
 		togglecase = (i + 1 >= fmtlen || fmt[i + 1] != '?');
-		isset = (state.led_mask & (1 << (key == 'n')));
+		isset = (xkb_leds & (1 << (key == 'n')));
 
 		if (togglecase)
-			buf[n++] = isset ? toupper(key) : key;
+			s->buf[n++] = isset ? toupper(key) : key;
 		else if (isset)
-			buf[n++] = fmt[i];
+			s->buf[n++] = fmt[i];
 	}
 
-	buf[n] = 0;
-	return buf;
+	s->buf[n] = 0;
+	return s->buf;
 }
+#endif
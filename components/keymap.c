@@ -1,11 +1,10 @@
 /* See LICENSE file for copyright and license details. */
+#include "../slstatus.h"
+
+#ifdef USE_XKB
 #include <ctype.h>
-#include <stdlib.h>
 #include <string.h>
-#include <X11/XKBlib.h>
-#include <X11/Xlib.h>
 
-#include "../slstatus.h"
 #include "../util.h"
 
 static int
@@ -45,42 +44,19 @@ get_layout(char *syms, int grp_num)
 }
 
 const char *
-keymap(const char *unused)
+keymap(struct seg *s, const char *unused)
 {
-	Display *dpy;
-	XkbDescRec *desc;
-	XkbStateRec state;
-	char *symbols;
+	char symbols[sizeof(xkb_symbols)];
 	const char *layout;
 
-	layout = NULL;
+	if (!xkb_ready || !xkb_symbols[0])
+		return NULL;
 
-	if (!(dpy = XOpenDisplay(NULL))) {
-		warn("XOpenDisplay: Failed to open display");
+	/* get_layout() tokenizes in place */
+	memcpy(symbols, xkb_symbols, sizeof(symbols));
+	if (!(layout = get_layout(symbols, xkb_group)))
 		return NULL;
-	}
-	if (!(desc = XkbAllocKeyboard())) {
-		warn("XkbAllocKeyboard: Failed to allocate keyboard");
-		goto end;
-	}
-	if (XkbGetNames(dpy, XkbSymbolsNameMask, desc)) {
-		warn("XkbGetNames: Failed to retrieve key symbols");
-		goto end;
-	}
-	if (XkbGetState(dpy, XkbUseCoreKbd, &state)) {
-		warn("XkbGetState: Failed to retrieve keyboard state");
-		goto end;
-	}
-	if (!(symbols = XGetAtomName(dpy, desc->names->symbols))) {
-		warn("XGetAtomName: Failed to get atom name");
-		goto end;
-	}
-	layout = bprintf("%s", get_layout(symbols, state.group));
-	XFree(symbols);
-end:
-	XkbFreeKeyboard(desc, XkbSymbolsNameMask, 1);
-	if (XCloseDisplay(dpy))
-		warn("XCloseDisplay: Failed to close display");
 
-	return layout;
+	return bprintf(s, "%s", layout);
 }
+#endif
@@ -6,7 +6,7 @@
 #include "../util.h"
 
 const char *
-load_avg(const char *unused)
+load_avg(struct seg *s, const char *unused)
 {
 	double avgs[3];
 
@@ -15,5 +15,5 @@ load_avg(const char *unused)
 		return NULL;
 	}
 
-	return bprintf("%.2f %.2f %.2f", avgs[0], avgs[1], avgs[2]);
+	return bprintf(s, "%.2f %.2f %.2f", avgs[0], avgs[1], avgs[2]);
 }
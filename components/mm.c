@@ -1,166 +1,321 @@
+#include "../slstatus.h"
+
+#ifdef USE_MM
 #include <stdio.h>
 #include <libmm-glib.h>
 
-#include "../slstatus.h"
-#include "../queue.h"
+#include "../bus.h"
+#include "../registry.h"
 #include "../util.h"
 
 typedef struct mm_t {
-	TAILQ_ENTRY(mm_t) entry;
-	char *iface;
+	const char *iface;
 
+	MMObject *object;
 	MMModem *modem;
+	MMModem3gpp *modem3gpp;
+	gulong state_id;
+	gulong sq_id;
+	gulong tech_id;
+	gulong operator_id;
+
 	MMModemState state;
-	guint sq;
-	int sq_id;
+	struct quant sq;
+	MMModemAccessTechnology tech;
+	char operator[64];
 } mm_t;
 
-TAILQ_HEAD(mm_q, mm_t);
+/* signal quality steps of the modem icons */
+static const int mm_sq_levels[] = { 25, 50, 70 };
+static const char *mm_sq_icons[] = { "󰢿", "󰢼", "󰢽", "󰢾" };
 
-struct mm_q mm_queue;
+/* modems by the name of each of their ports (wwan0, cdc-wdm0, ...) */
+struct registry mm_registry;
+unsigned int mm_gen = 1;
 MMManager *mm_manager;
 
-void
-mm_device_added_callback(MMObject *object, GParamSpec *pspec, gpointer user_data)
+static void
+mm_state_callback(MMModem *modem, GParamSpec *pspec, gpointer user_data)
 {
-	printf("##### OBJECT ADDED\n");
+	MMModemState state;
+	mm_t *mm = (mm_t *)user_data;
+
+	state = mm_modem_get_state(modem);
+	if (state != mm->state) {
+		mm->state = state;
+		kill(getpid(), SIGRTMIN + MM_SIGNAL);
+	}
 }
 
-void
-mm_device_removed_callback(MMObject *object, GParamSpec *pspec, gpointer user_data)
+static void
+mm_sq_callback(MMModem *modem, GParamSpec *pspec, gpointer user_data)
 {
-	printf("##### OBJECT REMOVED\n");
+	mm_t *mm = (mm_t *)user_data;
+
+	if (qset(&mm->sq, mm_modem_get_signal_quality(modem, NULL)))
+		kill(getpid(), SIGRTMIN + MM_SIGNAL);
 }
 
-void
-mm_init(void)
+static void
+mm_tech_callback(MMModem *modem, GParamSpec *pspec, gpointer user_data)
 {
-	TAILQ_INIT(&mm_queue);
+	MMModemAccessTechnology tech;
+	mm_t *mm = (mm_t *)user_data;
 
-	GDBusConnection *bus = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, NULL);
-	if (!bus)
-		return;
+	tech = mm_modem_get_access_technologies(modem);
+	if (tech != mm->tech) {
+		mm->tech = tech;
+		kill(getpid(), SIGRTMIN + MM_SIGNAL);
+	}
+}
 
-	mm_manager = mm_manager_new_sync(bus, G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE, NULL, NULL);
-	if (!mm_manager)
+static int
+mm_set_operator(mm_t *mm)
+{
+	const char *name = NULL;
+
+	if (mm->modem3gpp)
+		name = mm_modem_3gpp_get_operator_name(mm->modem3gpp);
+	if (!name)
+		name = "";
+	if (!strncmp(mm->operator, name, sizeof(mm->operator) - 1))
+		return 0;
+
+	snprintf(mm->operator, sizeof(mm->operator), "%s", name);
+	return 1;
+}
+
+static void
+mm_operator_callback(MMModem3gpp *modem3gpp, GParamSpec *pspec, gpointer user_data)
+{
+	if (mm_set_operator((mm_t *)user_data))
+		kill(getpid(), SIGRTMIN + MM_SIGNAL);
+}
+
+static void
+mm_attach(mm_t *mm, MMObject *object, MMModem *modem)
+{
+	mm->object = g_object_ref(object);
+	mm->modem = g_object_ref(modem);
+	mm->modem3gpp = mm_object_get_modem_3gpp(object);
+
+	mm->state = mm_modem_get_state(modem);
+	mm->tech = mm_modem_get_access_technologies(modem);
+	qinit(&mm->sq, mm_sq_levels, LEN(mm_sq_levels),
+	      mm_modem_get_signal_quality(modem, NULL));
+	mm_set_operator(mm);
+
+	mm->state_id = g_signal_connect(modem, "notify::state", G_CALLBACK(mm_state_callback), mm);
+	mm->sq_id = g_signal_connect(modem, "notify::signal-quality", G_CALLBACK(mm_sq_callback), mm);
+	mm->tech_id = g_signal_connect(modem, "notify::access-technologies", G_CALLBACK(mm_tech_callback), mm);
+	if (mm->modem3gpp)
+		mm->operator_id = g_signal_connect(mm->modem3gpp, "notify::operator-name", G_CALLBACK(mm_operator_callback), mm);
+
+	kill(getpid(), SIGRTMIN + MM_SIGNAL);
+}
+
+static void
+mm_detach(mm_t *mm)
+{
+	if (!mm->modem)
 		return;
 
-	/*
-	g_signal_connect(mm_manager, "object-added", G_CALLBACK(mm_device_added_callback), NULL);
-	g_signal_connect(mm_manager, "object-removed", G_CALLBACK(mm_device_removed_callback), NULL);
-	*/
+	g_signal_handler_disconnect(mm->modem, mm->state_id);
+	g_signal_handler_disconnect(mm->modem, mm->sq_id);
+	g_signal_handler_disconnect(mm->modem, mm->tech_id);
+	g_object_unref(mm->modem);
+
+	if (mm->modem3gpp) {
+		g_signal_handler_disconnect(mm->modem3gpp, mm->operator_id);
+		g_object_unref(mm->modem3gpp);
+	}
+
+	g_object_unref(mm->object);
+
+	mm->object = NULL;
+	mm->modem = NULL;
+	mm->modem3gpp = NULL;
+	mm->state_id = mm->sq_id = mm->tech_id = mm->operator_id = 0;
+	mm->state = MM_MODEM_STATE_UNKNOWN;
+	mm->tech = MM_MODEM_ACCESS_TECHNOLOGY_UNKNOWN;
+	mm->operator[0] = '\0';
+
+	kill(getpid(), SIGRTMIN + MM_SIGNAL);
 }
 
-void
-mm_modem_callback(MMModem *modem, GParamSpec *pspec, gpointer user_data)
+static void
+mm_object_added_callback(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data)
 {
-	const gchar *name;
-	guint sq;
+	const MMModemPortInfo *ports;
+	MMModem *modem;
 	mm_t *mm;
-	MMModemState state;
+	guint i, len;
+	uintptr_t key;
+	void *val;
 
-	mm = (mm_t *)user_data;
-	name = g_param_spec_get_name(pspec);
+	if (!(modem = mm_object_peek_modem(MM_OBJECT(object))))
+		return;
+	if (!mm_modem_peek_ports(modem, &ports, &len))
+		return;
 
-	if (!strcmp(name, "state")) {
-		g_object_get(modem, "state", &state, NULL);
-		if (state != mm->state) {
-			mm->state = state;
-			kill(getpid(), SIGRTMIN + MM_SIGNAL);
-		}
-	} else if (!strcmp(name, "signal-quality")) {
-		g_object_get(modem, "signal-quality", &sq, NULL);
-		if (sq != mm->sq) {
-			mm->sq = sq;
-			kill(getpid(), SIGRTMIN + MM_SIGNAL);
+	for (i = 0; i < len; i++) {
+		key = REG_KEY(ports[i].name);
+		if (reg_get(&mm_registry, key, &val)) {
+			mm = val;
+			mm_detach(mm);
+		} else {
+			if (!(mm = calloc(1, sizeof(mm_t))))
+				die("calloc:");
+			mm->iface = intern(ports[i].name);
+			reg_put(&mm_registry, key, mm);
+
+			/* segments that missed this port may bind now */
+			mm_gen++;
 		}
+
+		mm_attach(mm, MM_OBJECT(object), modem);
 	}
 }
 
-mm_t *
-mm_find(const char *iface)
+static void
+mm_object_removed_callback(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data)
 {
+	size_t iter = 0;
 	mm_t *mm;
+	void *val;
 
-	TAILQ_FOREACH(mm, &mm_queue, entry)
-		if (!strcmp(mm->iface, iface))
-			return mm;
-
-	GList *devices, *iter;
-	MMModem *modem;
-	const MMModemPortInfo *ports;
-	guint len;
+	while (reg_next(&mm_registry, &iter, &val)) {
+		mm = val;
+		if (mm->object == MM_OBJECT(object))
+			mm_detach(mm);
+	}
+}
 
-	devices = g_dbus_object_manager_get_objects(G_DBUS_OBJECT_MANAGER(mm_manager));
-	for (iter = devices; iter; iter = iter->next) {
-		modem = mm_object_get_modem(iter->data);
-		mm_modem_peek_ports(modem, &ports, &len);
+static void
+mm_manager_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GList *objects, *iter;
 
-		for (guint i = 0; i < len; i++) {
-			if (!strcmp(ports[i].name, iface)) {
-				mm = calloc(1, sizeof(mm_t));
-				mm->iface = strdup(iface);
-				mm->modem = modem;
-				mm->state = mm_modem_get_state(modem);
-				mm->sq = mm_modem_get_signal_quality(modem, NULL);
+	mm_manager = mm_manager_new_finish(res, NULL);
+	trace("mm", mm_manager != NULL);
+	if (!mm_manager)
+		return;
 
-				TAILQ_INSERT_TAIL(&mm_queue, mm, entry);
+	g_signal_connect(mm_manager, "object-added", G_CALLBACK(mm_object_added_callback), NULL);
+	g_signal_connect(mm_manager, "object-removed", G_CALLBACK(mm_object_removed_callback), NULL);
 
-				mm->sq_id = g_signal_connect(modem, "notify", G_CALLBACK(mm_modem_callback), mm);
+	objects = g_dbus_object_manager_get_objects(G_DBUS_OBJECT_MANAGER(mm_manager));
+	for (iter = objects; iter; iter = iter->next)
+		mm_object_added_callback(G_DBUS_OBJECT_MANAGER(mm_manager), iter->data, NULL);
+	g_list_free_full(objects, g_object_unref);
+}
 
-				return mm;
-			}
-		}
+void
+mm_init(void)
+{
+	if (!bus_conn) {
+		trace("mm", 0);
+		return;
 	}
 
-	return NULL;
+	mm_manager_new(bus_conn, G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE, NULL, mm_manager_callback, NULL);
 }
 
 void
-mm_tick(void)
+mm_free(void)
 {
-	while (g_main_context_iteration(NULL, FALSE));
+	size_t iter = 0;
+	void *val;
+
+	while (reg_next(&mm_registry, &iter, &val)) {
+		mm_detach(val);
+		free(val);
+	}
+
+	reg_free(&mm_registry);
+
+	if (mm_manager) {
+		g_object_unref(mm_manager);
+		mm_manager = NULL;
+	}
 }
 
-void
-mm_free(void)
+mm_t *
+mm_find(const char *iface)
 {
-	mm_t *mm;
+	void *val;
 
-	while ((mm = TAILQ_FIRST(&mm_queue))) {
-		TAILQ_REMOVE(&mm_queue, mm, entry);
+	return reg_get(&mm_registry, REG_KEY(iface), &val) ? val : NULL;
+}
+
+static mm_t *
+mm_bind(struct seg *s, const char *iface, int gran)
+{
+	if (!s->handle && s->gen != mm_gen) {
+		s->gen = mm_gen;
+		if ((s->handle = mm_find(iface)))
+			qbind(&((mm_t *)s->handle)->sq, gran);
 	}
+
+	return s->handle;
 }
 
 const char *
-mm_line(const char *iface)
+mm_line(struct seg *s, const char *iface)
 {
-	char *icon;
 	mm_t *mm;
 
-	mm = mm_find(iface);
-	if (!mm)
+	mm = mm_bind(s, iface, GRAN_ICON);
+	if (!mm || !mm->modem)
 		return NULL;
 
-	if (mm->state == MM_MODEM_STATE_CONNECTED) {
-		if (mm->sq < 25)
-			icon = "󰢿";
-		else if (mm->sq < 50)
-			icon = "󰢼";
-		else if (mm->sq < 70)
-			icon = "󰢽";
-		else
-			icon = "󰢾";
-
-		return icon;
-	}
+	if (mm->state == MM_MODEM_STATE_CONNECTED)
+		return mm_sq_icons[mm->sq.level];
+
+	return NULL;
+}
+
+const char *
+mm_perc(struct seg *s, const char *iface)
+{
+	mm_t *mm = mm_bind(s, iface, GRAN_VALUE);
+	return (mm && mm->modem) ? vnum(s, VAL_PERC, mm->sq.val) : NULL;
+}
+
+const char *
+mm_tech(struct seg *s, const char *iface)
+{
+	mm_t *mm = mm_bind(s, iface, GRAN_NONE);
+
+	if (!mm || !mm->modem)
+		return NULL;
+
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_5GNR)
+		return "5G";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_LTE)
+		return "LTE";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_HSPA_PLUS)
+		return "H+";
+	if (mm->tech & (MM_MODEM_ACCESS_TECHNOLOGY_HSPA |
+	                MM_MODEM_ACCESS_TECHNOLOGY_HSDPA |
+	                MM_MODEM_ACCESS_TECHNOLOGY_HSUPA))
+		return "H";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_UMTS)
+		return "3G";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_EDGE)
+		return "E";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_GPRS)
+		return "G";
+	if (mm->tech & MM_MODEM_ACCESS_TECHNOLOGY_GSM)
+		return "2G";
 
 	return NULL;
 }
 
 const char *
-mm_perc(const char *iface)
+mm_operator(struct seg *s, const char *iface)
 {
-	mm_t *mm = mm_find(iface);
-	return mm ? bprintf("%u", mm->sq) : NULL;
+	mm_t *mm = mm_bind(s, iface, GRAN_NONE);
+	return (mm && mm->operator[0]) ? mm->operator : NULL;
 }
+#endif
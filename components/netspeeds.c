@@ -1,5 +1,4 @@
 /* See LICENSE file for copyright and license details. */
-#include <limits.h>
 #include <stdio.h>
 
 #include "../slstatus.h"
@@ -7,50 +6,60 @@
 
 #if defined(__linux__)
 	#include <stdint.h>
+	#include <stdlib.h>
 
 	#define NET_RX_BYTES "/sys/class/net/%s/statistics/rx_bytes"
 	#define NET_TX_BYTES "/sys/class/net/%s/statistics/tx_bytes"
 
-	const char *
-	netspeed_rx(const char *interface)
+	struct netspeed {
+		struct pfile *file;
+		uintmax_t bytes;
+	};
+
+	static void
+	netspeed_unbind(void *p)
 	{
-		uintmax_t oldrxbytes;
-		static uintmax_t rxbytes;
+		struct netspeed *n = p;
+
+		pfclose(n->file);
+		free(n);
+	}
+
+	static const char *
+	netspeed(struct seg *s, const char *fmt, const char *interface)
+	{
+		struct netspeed *n;
+		uintmax_t oldbytes;
 		extern const unsigned int interval;
-		char path[PATH_MAX];
 
-		oldrxbytes = rxbytes;
+		if (!(n = s->handle)) {
+			if (!(n = calloc(1, sizeof(*n))))
+				die("calloc:");
+			n->file = pfopen(fmt, interface);
+			s->handle = n;
+			s->unbind = netspeed_unbind;
+		}
 
-		if (esnprintf(path, sizeof(path), NET_RX_BYTES, interface) < 0)
-			return NULL;
-		if (pscanf(path, "%ju", &rxbytes) != 1)
+		oldbytes = n->bytes;
+
+		if (pfscanf(n->file, "%ju", &n->bytes) != 1)
 			return NULL;
-		if (oldrxbytes == 0)
+		if (oldbytes == 0)
 			return NULL;
 
-		return fmt_human((rxbytes - oldrxbytes) * 1000 / interval,
-		                 1024);
+		return vnum(s, VAL_BYTES, (n->bytes - oldbytes) * 1000 / interval);
 	}
 
 	const char *
-	netspeed_tx(const char *interface)
+	netspeed_rx(struct seg *s, const char *interface)
 	{
-		uintmax_t oldtxbytes;
-		static uintmax_t txbytes;
-		extern const unsigned int interval;
-		char path[PATH_MAX];
-
-		oldtxbytes = txbytes;
-
-		if (esnprintf(path, sizeof(path), NET_TX_BYTES, interface) < 0)
-			return NULL;
-		if (pscanf(path, "%ju", &txbytes) != 1)
-			return NULL;
-		if (oldtxbytes == 0)
-			return NULL;
+		return netspeed(s, NET_RX_BYTES, interface);
+	}
 
-		return fmt_human((txbytes - oldtxbytes) * 1000 / interval,
-		                 1024);
+	const char *
+	netspeed_tx(struct seg *s, const char *interface)
+	{
+		return netspeed(s, NET_TX_BYTES, interface);
 	}
 #elif defined(__OpenBSD__) | defined(__FreeBSD__)
 	#include <ifaddrs.h>
@@ -60,7 +69,7 @@
 	#include <sys/socket.h>
 
 	const char *
-	netspeed_rx(const char *interface)
+	netspeed_rx(struct seg *s, const char *interface)
 	{
 		struct ifaddrs *ifal, *ifa;
 		struct if_data *ifd;
@@ -89,12 +98,11 @@
 		if (oldrxbytes == 0)
 			return NULL;
 
-		return fmt_human((rxbytes - oldrxbytes) * 1000 / interval,
-		                 1024);
+		return vnum(s, VAL_BYTES, (rxbytes - oldrxbytes) * 1000 / interval);
 	}
 
 	const char *
-	netspeed_tx(const char *interface)
+	netspeed_tx(struct seg *s, const char *interface)
 	{
 		struct ifaddrs *ifal, *ifa;
 		struct if_data *ifd;
@@ -123,7 +131,6 @@
 		if (oldtxbytes == 0)
 			return NULL;
 
-		return fmt_human((txbytes - oldtxbytes) * 1000 / interval,
-		                 1024);
+		return vnum(s, VAL_BYTES, (txbytes - oldtxbytes) * 1000 / interval);
 	}
 #endif
@@ -1,191 +1,324 @@
+#include "../slstatus.h"
+
+#ifdef USE_NM
+#include <arpa/inet.h>
+#include <stdio.h>
+
 #include <NetworkManager.h>
 
-#include "../slstatus.h"
-#include "../queue.h"
+#include "../bus.h"
+#include "../registry.h"
 #include "../util.h"
 
+/* 32 octet SSID, each may widen to 3 bytes when converted to UTF-8 */
+#define NM_ESSID_LEN (32 * 3 + 1)
+/* upper bound for any call, a wedged daemon must not stall the bar */
+#define NM_TIMEOUT 1000
+
 typedef struct nm_t {
-	TAILQ_ENTRY(nm_t) entry;
-	char *iface;
-	char *ipv4;
-	char *ipv6;
+	const char *iface;
+	char ipv4[INET_ADDRSTRLEN];
+	char ipv6[INET6_ADDRSTRLEN];
 	NMDevice *device;
 	NMDeviceState state;
 	int state_id;
 
 	NMAccessPoint *ap;
-	char *essid;
-	int ss;
+	char essid[NM_ESSID_LEN];
+	struct quant ss;
 	int ap_id;
 	int ss_id;
 
+	/* org.freedesktop.NetworkManager.Device.Statistics */
 	GDBusProxy *proxy;
+	int stats;
+	int pending;
+	int stats_id;
+	guint64 rx;
+	guint64 tx;
+	guint64 rx_rate;
+	guint64 tx_rate;
+	gint64 stamp;
 } nm_t;
 
-TAILQ_HEAD(nm_q, nm_t);
+typedef struct nm_vpn_t {
+	NMActiveConnection *ac;
+	NMActiveConnectionState state;
+	int state_id;
+} nm_vpn_t;
+
+/* signal strength steps of the wifi icons */
+static const int nm_ss_levels[] = { 20, 40, 60, 80 };
+static const char *nm_ss_icons[] = { "󰤯", "󰤟", "󰤢", "󰤥", "󰤨" };
 
-struct nm_q nm_queue;
+struct registry nm_registry;
+struct registry nm_vpns;
+unsigned int nm_gen = 1;
 NMClient *nm_client;
 
-void
-nm_init(void)
+static void nm_attach(nm_t *nm, NMDevice *device);
+static void nm_detach(nm_t *nm);
+static void nm_stats_start(nm_t *nm);
+
+static void
+nm_device_added_callback(NMClient *client, NMDevice *device, gpointer user_data)
 {
-	GError *error = NULL;
+	uintptr_t key;
+	void *val;
+
+	key = REG_KEY(nm_device_get_iface(device));
+	if (!reg_get(&nm_registry, key, &val))
+		return;
+
+	if (!val) {
+		reg_del(&nm_registry, key);
+		nm_gen++;
+	} else if (!((nm_t *)val)->device)
+		nm_attach(val, device);
+}
 
-	TAILQ_INIT(&nm_queue);
+static void
+nm_device_removed_callback(NMClient *client, NMDevice *device, gpointer user_data)
+{
+	void *val;
 
-	nm_client = nm_client_new(NULL, &error);
+	if (reg_get(&nm_registry, REG_KEY(nm_device_get_iface(device)), &val) &&
+			val && ((nm_t *)val)->device == device)
+		nm_detach(val);
+}
+
+static void
+nm_vpn_state_callback(NMActiveConnection *ac, GParamSpec *pspec, gpointer user_data)
+{
+	nm_vpn_t *vpn = (nm_vpn_t *)user_data;
+	NMActiveConnectionState state;
+
+	state = nm_active_connection_get_state(ac);
+	if (state != vpn->state) {
+		vpn->state = state;
+		kill(getpid(), SIGRTMIN + NM_SIGNAL);
+	}
+}
+
+static void
+nm_active_connection_added_callback(NMClient *client, NMActiveConnection *ac, gpointer user_data)
+{
+	const char *type;
+	nm_vpn_t *vpn;
+
+	/* wireguard profiles are plain devices to NM, not VPN connections */
+	type = nm_active_connection_get_connection_type(ac);
+	if (!nm_active_connection_get_vpn(ac) &&
+			!(type && !strcmp(type, NM_SETTING_WIREGUARD_SETTING_NAME)))
+		return;
+
+	if (!(vpn = calloc(1, sizeof(nm_vpn_t))))
+		die("calloc:");
+
+	vpn->ac = g_object_ref(ac);
+	vpn->state = nm_active_connection_get_state(ac);
+	vpn->state_id = g_signal_connect(
+			ac,
+			"notify::" NM_ACTIVE_CONNECTION_STATE,
+			G_CALLBACK(nm_vpn_state_callback),
+			vpn);
+
+	reg_put(&nm_vpns, (uintptr_t)ac, vpn);
+
+	kill(getpid(), SIGRTMIN + NM_SIGNAL);
+}
+
+static void
+nm_vpn_free(nm_vpn_t *vpn)
+{
+	g_signal_handler_disconnect(vpn->ac, vpn->state_id);
+	g_object_unref(vpn->ac);
+	free(vpn);
+}
+
+static void
+nm_active_connection_removed_callback(NMClient *client, NMActiveConnection *ac, gpointer user_data)
+{
+	void *val;
+
+	if (!reg_get(&nm_vpns, (uintptr_t)ac, &val))
+		return;
+
+	reg_del(&nm_vpns, (uintptr_t)ac);
+	nm_vpn_free(val);
+
+	kill(getpid(), SIGRTMIN + NM_SIGNAL);
+}
+
+static void
+nm_client_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	const GPtrArray *acs;
+	guint i;
+
+	nm_client = nm_client_new_finish(res, NULL);
+	trace("nm", nm_client != NULL);
+	if (!nm_client)
+		return;
+
+	g_signal_connect(nm_client, "device-added", G_CALLBACK(nm_device_added_callback), NULL);
+	g_signal_connect(nm_client, "device-removed", G_CALLBACK(nm_device_removed_callback), NULL);
+	g_signal_connect(nm_client, NM_CLIENT_ACTIVE_CONNECTION_ADDED, G_CALLBACK(nm_active_connection_added_callback), NULL);
+	g_signal_connect(nm_client, NM_CLIENT_ACTIVE_CONNECTION_REMOVED, G_CALLBACK(nm_active_connection_removed_callback), NULL);
+
+	acs = nm_client_get_active_connections(nm_client);
+	for (i = 0; acs && i < acs->len; i++)
+		nm_active_connection_added_callback(nm_client, g_ptr_array_index(acs, i), NULL);
+
+	/* let segments that came up empty bind now */
+	nm_gen++;
+	kill(getpid(), SIGRTMIN + NM_SIGNAL);
 }
 
 void
-nm_tick(void)
+nm_init(void)
 {
-	while (g_main_context_iteration(NULL, FALSE));
+	nm_client_new_async(NULL, nm_client_callback, NULL);
 }
 
 void
 nm_free(void)
 {
+	size_t iter = 0;
+	void *val;
 	nm_t *nm;
 
-	while ((nm = TAILQ_FIRST(&nm_queue))) {
-		TAILQ_REMOVE(&nm_queue, nm, entry);
+	while (reg_next(&nm_registry, &iter, &val)) {
+		nm = val;
+		nm_detach(nm);
+		free(nm);
+	}
 
-		if (nm->ipv4) {
-			free(nm->ipv4);
-			nm->ipv4 = NULL;
-		}
+	reg_free(&nm_registry);
 
-		if (nm->ipv6) {
-			free(nm->ipv6);
-			nm->ipv6 = NULL;
-		}
+	/* the refresh rate resets from nm_detach() must go out before we exit */
+	if (bus_conn)
+		g_dbus_connection_flush_sync(bus_conn, NULL, NULL);
 
-		if (nm->essid) {
-			free(nm->essid);
-			nm->essid = NULL;
-		}
+	iter = 0;
+	while (reg_next(&nm_vpns, &iter, &val))
+		nm_vpn_free(val);
 
-		if (nm->state_id) {
-			g_signal_handler_disconnect(nm->device, nm->state_id);
-			nm->state_id = 0;
-		}
-
-		if (nm->proxy) {
-			g_object_unref(nm->proxy);
-			nm->proxy = NULL;
-		}
-	}
+	reg_free(&nm_vpns);
 
 	if (nm_client) {
 		g_object_unref(nm_client);
 		nm_client = NULL;
 	}
+}
 
-	free(nm);
+static int
+nm_copy(char *buf, size_t size, const char *val)
+{
+	if (!val)
+		val = "";
+	if (!strncmp(buf, val, size - 1))
+		return 0;
+
+	snprintf(buf, size, "%s", val);
+	return 1;
+}
+
+static int
+nm_address(char *buf, size_t size, NMIPConfig *config)
+{
+	GPtrArray *addresses;
+
+	addresses = config ? nm_ip_config_get_addresses(config) : NULL;
+	if (!addresses || !addresses->len)
+		return nm_copy(buf, size, NULL);
+
+	return nm_copy(buf, size, nm_ip_address_get_address(g_ptr_array_index(addresses, 0)));
 }
 
 void
 nm_update(nm_t *nm)
 {
-	GPtrArray *addresses;
-	NMIPConfig *config;
-
-	nm->state = nm_device_get_state(nm->device);
-
-	if (nm->state == NM_DEVICE_STATE_ACTIVATED) {
-		config = nm_device_get_ip4_config(nm->device);
-		if (config) {
-			addresses = nm_ip_config_get_addresses(config);
-			if (addresses && addresses->len > 0) {
-				if (nm->ipv4)
-					free(nm->ipv4);
-				nm->ipv4 = strdup(nm_ip_address_get_address(g_ptr_array_index(addresses, 0)));
-				kill(getpid(), SIGRTMIN + NM_SIGNAL);
-			}
-		}
+	NMDeviceState state;
+	int changed;
 
-		config = nm_device_get_ip6_config(nm->device);
-		if (config) {
-			addresses = nm_ip_config_get_addresses(config);
-			if (addresses && addresses->len > 0) {
-				if (nm->ipv6)
-					free(nm->ipv6);
-				nm->ipv6 = strdup(nm_ip_address_get_address(g_ptr_array_index(addresses, 0)));
-				kill(getpid(), SIGRTMIN + NM_SIGNAL);
-			}
-		}
-	} else {
-		if (nm->ipv4) {
-			free(nm->ipv4);
-			nm->ipv4 = NULL;
-		}
+	state = nm_device_get_state(nm->device);
+	changed = state != nm->state;
+	nm->state = state;
 
-		if (nm->ipv6) {
-			free(nm->ipv6);
-			nm->ipv6 = NULL;
-		}
+	if (state == NM_DEVICE_STATE_ACTIVATED) {
+		changed |= nm_address(nm->ipv4, sizeof(nm->ipv4), nm_device_get_ip4_config(nm->device));
+		changed |= nm_address(nm->ipv6, sizeof(nm->ipv6), nm_device_get_ip6_config(nm->device));
+	} else {
+		changed |= nm_copy(nm->ipv4, sizeof(nm->ipv4), NULL);
+		changed |= nm_copy(nm->ipv6, sizeof(nm->ipv6), NULL);
+	}
 
+	if (changed)
 		kill(getpid(), SIGRTMIN + NM_SIGNAL);
-	}
 }
 
-
 static void
 nm_signal_strength_callback(NMAccessPoint *ap, GParamSpec *pspec, gpointer user_data)
 {
-	int ss;
 	nm_t *nm = (nm_t *)user_data;
 
-	ss = nm_access_point_get_strength(ap);
-	if (ss != nm->ss) {
-		nm->ss = ss;
+	if (qset(&nm->ss, nm_access_point_get_strength(ap)))
 		kill(getpid(), SIGRTMIN + NM_SIGNAL);
-	}
 }
 
-static void
-nm_access_point_callback(NMDeviceWifi *device, GParamSpec *pspec, gpointer user_data)
+/* switch the tracked access point, returns whether anything shown changed */
+static int
+nm_set_ap(nm_t *nm, NMAccessPoint *ap)
 {
-	const guint8 *essid;
+	const guint8 *data;
 	GBytes *ssid;
 	gsize size;
-	NMAccessPoint *ap;
-	nm_t *nm;
-
-	nm = (nm_t *)user_data;
-	ap = nm_device_wifi_get_active_access_point(device);
+	char *essid;
+	int changed, ss;
 
-	if (ap) {
-		nm->ap = ap;
+	if (ap == nm->ap)
+		return 0;
 
-		ssid = nm_access_point_get_ssid(ap);
-		if (ssid) {
-			essid = g_bytes_get_data(ssid, &size);
-			nm->essid = strdup(nm_utils_ssid_to_utf8(essid, size));
-		}
+	if (nm->ap) {
+		g_signal_handler_disconnect(nm->ap, nm->ss_id);
+		g_object_unref(nm->ap);
+		nm->ss_id = 0;
+		nm->ap = NULL;
+	}
 
-		nm->ss = nm_access_point_get_strength(ap);
+	essid = NULL;
+	ss = 0;
+	if (ap) {
+		nm->ap = g_object_ref(ap);
 		nm->ss_id = g_signal_connect(
 				ap,
 				"notify::" NM_ACCESS_POINT_STRENGTH,
 				G_CALLBACK(nm_signal_strength_callback),
 				nm);
 
-		kill(getpid(), SIGRTMIN + NM_SIGNAL);
-	} else if (nm->ap) {
-		g_signal_handler_disconnect(nm->ap, nm->ss_id);
-		if (nm->essid) {
-			free(nm->essid);
-			nm->essid = NULL;
+		if ((ssid = nm_access_point_get_ssid(ap))) {
+			data = g_bytes_get_data(ssid, &size);
+			essid = nm_utils_ssid_to_utf8(data, size);
 		}
+		ss = nm_access_point_get_strength(ap);
+	}
 
-		nm->ap = NULL;
-		nm->ss = 0;
-		nm->ss_id = 0;
+	changed = nm_copy(nm->essid, sizeof(nm->essid), essid);
+	g_free(essid);
 
+	changed |= qset(&nm->ss, ss);
+
+	return changed;
+}
+
+static void
+nm_access_point_callback(NMDeviceWifi *device, GParamSpec *pspec, gpointer user_data)
+{
+	nm_t *nm = (nm_t *)user_data;
+
+	if (nm_set_ap(nm, nm_device_wifi_get_active_access_point(device)))
 		kill(getpid(), SIGRTMIN + NM_SIGNAL);
-	}
 }
 
 static void
@@ -196,74 +329,223 @@ nm_state_callback(NMDevice *device, GParamSpec *pspec, gpointer user_data)
 	nm_update(nm);
 }
 
-nm_t *
-nm_find(const char *iface)
+/* how often NetworkManager pushes the counters, 0 stops it */
+static void
+nm_stats_rate(nm_t *nm, guint32 ms)
 {
-	const guint8 *essid;
-	GBytes *ssid;
-	gsize size;
-	NMDevice *device;
-	nm_t *nm;
+	g_dbus_proxy_call(
+			nm->proxy,
+			"org.freedesktop.DBus.Properties.Set",
+			g_variant_new("(ssv)",
+				"org.freedesktop.NetworkManager.Device.Statistics",
+				"RefreshRateMs",
+				g_variant_new_uint32(ms)),
+			G_DBUS_CALL_FLAGS_NONE,
+			NM_TIMEOUT,
+			NULL,
+			NULL,
+			NULL);
+}
 
-	TAILQ_FOREACH(nm, &nm_queue, entry)
-		if (!strcmp(nm->iface, iface))
-			return nm;
+static void
+nm_stats_callback(GDBusProxy *proxy, GVariant *changed, const gchar *const *invalidated, gpointer user_data)
+{
+	guint64 rx, tx;
+	gint64 now, elapsed;
+	int found;
+	nm_t *nm = (nm_t *)user_data;
 
-	device = nm_client_get_device_by_iface(nm_client, iface);
-	if (!device)
-		return NULL;
+	rx = nm->rx;
+	tx = nm->tx;
+	found = g_variant_lookup(changed, "RxBytes", "t", &rx);
+	found |= g_variant_lookup(changed, "TxBytes", "t", &tx);
+	if (!found)
+		return;
+
+	now = g_get_monotonic_time();
+	elapsed = now - nm->stamp;
+
+	/*
+	 * the first push only establishes the baseline, as does one after
+	 * the counters went back (interface re-created)
+	 */
+	if (nm->stamp && elapsed > 0 && rx >= nm->rx && tx >= nm->tx) {
+		nm->rx_rate = (rx - nm->rx) * G_USEC_PER_SEC / elapsed;
+		nm->tx_rate = (tx - nm->tx) * G_USEC_PER_SEC / elapsed;
+		kill(getpid(), SIGRTMIN + NM_SIGNAL);
+	}
 
-	nm = calloc(1, sizeof(nm_t));
-	nm->iface = strdup(iface);
+	nm->rx = rx;
+	nm->tx = tx;
+	nm->stamp = now;
+}
+
+static void
+nm_stats_proxy_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GDBusProxy *proxy;
+	nm_t *nm = (nm_t *)user_data;
+	extern const unsigned int nm_stats_interval;
+
+	nm->pending = 0;
+	if (!(proxy = g_dbus_proxy_new_finish(res, NULL)))
+		return;
+
+	/* the device went away or was replaced while we waited */
+	if (nm->proxy || !nm->device ||
+			strcmp(g_dbus_proxy_get_object_path(proxy), nm_object_get_path(NM_OBJECT(nm->device)))) {
+		g_object_unref(proxy);
+		return;
+	}
+
+	nm->proxy = proxy;
+	nm->stats_id = g_signal_connect(nm->proxy, "g-properties-changed", G_CALLBACK(nm_stats_callback), nm);
+
+	/* counters are only pushed while a refresh rate is set */
+	nm_stats_rate(nm, nm_stats_interval);
+}
+
+static void
+nm_stats_start(nm_t *nm)
+{
+	if (nm->proxy || nm->pending || !nm->device || !bus_conn)
+		return;
+
+	nm->pending = 1;
+	g_dbus_proxy_new(
+			bus_conn,
+			G_DBUS_PROXY_FLAGS_NONE,
+			NULL,
+			"org.freedesktop.NetworkManager",
+			nm_object_get_path(NM_OBJECT(nm->device)),
+			"org.freedesktop.NetworkManager.Device.Statistics",
+			NULL,
+			nm_stats_proxy_callback,
+			nm);
+}
+
+/* segments run on the renderer thread, the proxy belongs to the bus thread */
+static gboolean
+nm_stats_idle(gpointer user_data)
+{
+	nm_stats_start((nm_t *)user_data);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+nm_attach(nm_t *nm, NMDevice *device)
+{
 	nm->device = device;
-	nm->state = nm_device_get_state(device);
-	nm->ap = NULL;
-	nm->essid = NULL;
-	nm->ap_id = 0;
-	nm->ss_id = 0;
-	nm->ss = 0;
 
 	nm_update(nm);
 
-	TAILQ_INSERT_TAIL(&nm_queue, nm, entry);
-
 	if (NM_IS_DEVICE_WIFI(nm->device)) {
-		nm->ap = nm_device_wifi_get_active_access_point((NMDeviceWifi *)nm->device);
 		nm->ap_id = g_signal_connect(
 				nm->device,
 				"notify::" NM_DEVICE_WIFI_ACTIVE_ACCESS_POINT,
 				G_CALLBACK(nm_access_point_callback),
 				nm);
 
-		if (nm->ap) {
-			ssid = nm_access_point_get_ssid(nm->ap);
-			if (ssid) {
-				essid = g_bytes_get_data(ssid, &size);
-				nm->essid = strdup(nm_utils_ssid_to_utf8(essid, size));
-			}
-
-			nm->ss = nm_access_point_get_strength(nm->ap);
-			nm->ss_id = g_signal_connect(
-					nm->ap,
-					"notify::" NM_ACCESS_POINT_STRENGTH,
-					G_CALLBACK(nm_signal_strength_callback),
-					nm);
-		}
+		nm_set_ap(nm, nm_device_wifi_get_active_access_point(NM_DEVICE_WIFI(nm->device)));
 	}
 
 	nm->state_id = g_signal_connect(nm->device, "notify::" NM_DEVICE_STATE, G_CALLBACK(nm_state_callback), nm);
 
+	if (nm->stats)
+		nm_stats_start(nm);
+}
+
+static void
+nm_detach(nm_t *nm)
+{
+	if (!nm->device)
+		return;
+
+	nm_set_ap(nm, NULL);
+
+	if (nm->ap_id) {
+		g_signal_handler_disconnect(nm->device, nm->ap_id);
+		nm->ap_id = 0;
+	}
+
+	if (nm->state_id) {
+		g_signal_handler_disconnect(nm->device, nm->state_id);
+		nm->state_id = 0;
+	}
+
+	if (nm->proxy) {
+		/* NetworkManager would keep polling for nobody */
+		nm_stats_rate(nm, 0);
+		g_signal_handler_disconnect(nm->proxy, nm->stats_id);
+		g_object_unref(nm->proxy);
+		nm->proxy = NULL;
+		nm->stats_id = 0;
+	}
+
+	nm->rx = nm->tx = 0;
+	nm->rx_rate = nm->tx_rate = 0;
+	nm->stamp = 0;
+
+	nm->ipv4[0] = '\0';
+	nm->ipv6[0] = '\0';
+	nm->device = NULL;
+	nm->state = NM_DEVICE_STATE_UNKNOWN;
+
+	kill(getpid(), SIGRTMIN + NM_SIGNAL);
+}
+
+nm_t *
+nm_find(const char *iface)
+{
+	NMDevice *device;
+	nm_t *nm;
+	uintptr_t key;
+	void *val;
+
+	key = REG_KEY(iface);
+	if (reg_get(&nm_registry, key, &val))
+		return val;
+
+	if (!nm_client)
+		return NULL;
+
+	device = nm_client_get_device_by_iface(nm_client, iface);
+	if (!device) {
+		reg_put(&nm_registry, key, NULL);
+		return NULL;
+	}
+
+	nm = calloc(1, sizeof(nm_t));
+	nm->iface = intern(iface);
+	qinit(&nm->ss, nm_ss_levels, LEN(nm_ss_levels), 0);
+
+	nm_attach(nm, device);
+
+	reg_put(&nm_registry, key, nm);
+
 	return nm;
 }
 
+static nm_t *
+nm_bind(struct seg *s, const char *iface, int gran)
+{
+	if (!s->handle && s->gen != nm_gen) {
+		s->gen = nm_gen;
+		if ((s->handle = nm_find(iface)))
+			qbind(&((nm_t *)s->handle)->ss, gran);
+	}
+
+	return s->handle;
+}
+
 const char *
-nm_line(const char *iface)
+nm_line(struct seg *s, const char *iface)
 {
-	char *icon;
+	const char *icon;
 	nm_t *nm;
 
-	nm = nm_find(iface);
-	if (!nm)
+	nm = nm_bind(s, iface, GRAN_ICON);
+	if (!nm || !nm->device)
 		return NULL;
 
 	if (nm->state != NM_DEVICE_STATE_ACTIVATED)
@@ -272,19 +554,10 @@ nm_line(const char *iface)
 	if (NM_IS_DEVICE_ETHERNET(nm->device))
 		return "󰈀";
 	else if (NM_IS_DEVICE_WIFI(nm->device)) {
-		if (nm->ss < 20)
-			icon = "󰤯";
-		else if (nm->ss < 40)
-			icon = "󰤟";
-		else if (nm->ss < 60)
-			icon = "󰤢";
-		else if (nm->ss < 80)
-			icon = "󰤥";
-		else
-			icon = "󰤨";
-
-		if (nm->essid)
-			return bprintf("%s %s", icon, nm->essid);
+		icon = nm_ss_icons[nm->ss.level];
+
+		if (nm->essid[0])
+			return bprintf(s, "%s %s", icon, nm->essid);
 
 		return icon;
 	}
@@ -293,22 +566,80 @@ nm_line(const char *iface)
 }
 
 const char *
-nm_ip4(const char *iface)
+nm_ip4(struct seg *s, const char *iface)
 {
-	nm_t *nm = nm_find(iface);
-	return nm ? nm->ipv4 : NULL;
+	nm_t *nm = nm_bind(s, iface, GRAN_NONE);
+	return (nm && nm->ipv4[0]) ? nm->ipv4 : NULL;
 }
 
 const char *
-nm_ip6(const char *iface)
+nm_ip6(struct seg *s, const char *iface)
 {
-	nm_t *nm = nm_find(iface);
-	return nm ? nm->ipv6 : NULL;
+	nm_t *nm = nm_bind(s, iface, GRAN_NONE);
+	return (nm && nm->ipv6[0]) ? nm->ipv6 : NULL;
 }
 
 const char *
-nm_mac(const char *iface)
+nm_mac(struct seg *s, const char *iface)
 {
-	nm_t *nm = nm_find(iface);
-	return nm ? nm_device_get_hw_address(nm->device) : NULL;
+	nm_t *nm = nm_bind(s, iface, GRAN_NONE);
+	return (nm && nm->device) ? nm_device_get_hw_address(nm->device) : NULL;
+}
+
+const char *
+nm_rx(struct seg *s, const char *iface)
+{
+	nm_t *nm = nm_bind(s, iface, GRAN_NONE);
+
+	if (!nm)
+		return NULL;
+	if (!nm->stats) {
+		nm->stats = 1;
+		g_main_context_invoke(bus_context, nm_stats_idle, nm);
+	}
+
+	return nm->stamp ? vnum(s, VAL_BYTES, nm->rx_rate) : NULL;
+}
+
+const char *
+nm_tx(struct seg *s, const char *iface)
+{
+	nm_t *nm = nm_bind(s, iface, GRAN_NONE);
+
+	if (!nm)
+		return NULL;
+	if (!nm->stats) {
+		nm->stats = 1;
+		g_main_context_invoke(bus_context, nm_stats_idle, nm);
+	}
+
+	return nm->stamp ? vnum(s, VAL_BYTES, nm->tx_rate) : NULL;
+}
+
+const char *
+nm_vpn(struct seg *s, const char *name)
+{
+	const char *id;
+	size_t iter = 0;
+	nm_vpn_t *vpn;
+	void *val;
+
+	while (reg_next(&nm_vpns, &iter, &val)) {
+		vpn = val;
+		id = nm_active_connection_get_id(vpn->ac);
+		if (!id || (name && strcmp(id, name)))
+			continue;
+
+		switch (vpn->state) {
+		case NM_ACTIVE_CONNECTION_STATE_ACTIVATED:
+			return name ? "󰖂" : bprintf(s, "󰖂 %s", id);
+		case NM_ACTIVE_CONNECTION_STATE_ACTIVATING:
+			return name ? "󰖂 …" : bprintf(s, "󰖂 %s …", id);
+		default:
+			break;
+		}
+	}
+
+	return NULL;
 }
+#endif
@@ -7,7 +7,7 @@
 #include "../util.h"
 
 const char *
-num_files(const char *path)
+num_files(struct seg *s, const char *path)
 {
 	struct dirent *dp;
 	DIR *dir;
@@ -28,5 +28,5 @@ num_files(const char *path)
 
 	closedir(dir);
 
-	return bprintf("%d", num);
+	return vnum(s, VAL_INT, num);
 }
@@ -1,40 +1,69 @@
+#include "../slstatus.h"
+
+#ifdef USE_PA
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include <pulse/pulseaudio.h>
 
-#include "../slstatus.h"
-#include "../queue.h"
+#include "../registry.h"
 #include "../util.h"
 
+/* sinks or sources, keyed by interned name (NULL for default) and index */
+struct pa_devices {
+	struct registry names;
+	struct registry indices;
+};
+
 typedef struct pa_t {
-	TAILQ_ENTRY(pa_t) entry;
-	char *sink;
+	struct pa_devices *devices;
+	struct pa_t *link;
+	const char *sink;
 	char *name;
 	char *description;
 	uint32_t index;
-	int volume;
+	struct quant volume;
 	int mute;
 } pa_t;
 
-TAILQ_HEAD(pa_q, pa_t);
-
-struct pa_q pa_queue;
+/* sink input or source output */
+typedef struct pa_stream_t {
+	uint32_t index;
+	uint32_t device;
+	int corked;
+	char *app;
+} pa_stream_t;
+
+/* volume steps of the speaker icons */
+static const int pa_volume_levels[] = { 34, 67 };
+static const char *pa_volume_icons[] = { "󰕿", "󰖀", "󰕾" };
+
+struct pa_devices pa_sinks;
+struct pa_devices pa_sources;
+struct registry pa_inputs;
+struct registry pa_outputs;
 pa_context *pa_ctx;
 pa_threaded_mainloop *pa_loop;
-int pa_state_callback_signal = 0;
+int pa_ready = 0;
 char *pa_default_sink;
+char *pa_default_source;
 
 pa_t *
-pa_find_by_index(uint32_t index)
+pa_find_by_index(struct pa_devices *devices, uint32_t index)
 {
-	pa_t *pa;
+	void *val;
 
-	TAILQ_FOREACH(pa, &pa_queue, entry)
-		if (pa->index == index)
-			return pa;
+	return reg_get(&devices->indices, index, &val) ? val : NULL;
+}
 
-	return NULL;
+pa_t *
+pa_lookup(struct pa_devices *devices, const char *device)
+{
+	void *val;
+
+	return reg_get(&devices->names, REG_KEY(device), &val) ? val : NULL;
 }
 
 void
@@ -46,68 +75,327 @@ pa_wait(pa_operation *op)
 	pa_operation_unref(op);
 }
 
-void
-pa_sink_info_callback(pa_context *ctx, const pa_sink_info *info, int eol, void *userdata)
+/* several names (e.g. the default and an explicit one) can share an index */
+static void
+pa_set_index(pa_t *pa, uint32_t index)
+{
+	struct registry *indices = &pa->devices->indices;
+	pa_t *head, *p;
+	void *val;
+
+	if (pa->index != PA_INVALID_INDEX && reg_get(indices, pa->index, &val)) {
+		head = val;
+		if (head == pa) {
+			head = pa->link;
+		} else {
+			for (p = head; p->link && p->link != pa; p = p->link)
+				;
+			if (p->link)
+				p->link = pa->link;
+		}
+
+		if (head)
+			reg_put(indices, pa->index, head);
+		else
+			reg_del(indices, pa->index);
+	}
+
+	pa->index = index;
+	pa->link = NULL;
+
+	if (index != PA_INVALID_INDEX) {
+		if (reg_get(indices, index, &val))
+			pa->link = val;
+		reg_put(indices, index, pa);
+	}
+}
+
+int
+pa_update(pa_t *pa, uint32_t index, const pa_cvolume *cvolume, int mute, const char *name, const char *description)
 {
 	int signal = 0;
 	int volume;
+
+	if (index != pa->index) {
+		pa_set_index(pa, index);
+		signal++;
+	}
+
+	volume = (int)(pa_cvolume_max(cvolume) * 100.0f / PA_VOLUME_NORM + 0.5f);
+	if (qset(&pa->volume, volume))
+		signal++;
+
+	if (mute != pa->mute) {
+		pa->mute = mute;
+		signal++;
+	}
+
+	if (!pa->name || strcmp(pa->name, name)) {
+		free(pa->name);
+		pa->name = strdup(name);
+		signal++;
+	}
+
+	if (!pa->description || strcmp(pa->description, description)) {
+		free(pa->description);
+		pa->description = strdup(description);
+		signal++;
+	}
+
+	return signal;
+}
+
+void
+pa_sink_info_callback(pa_context *ctx, const pa_sink_info *info, int eol, void *userdata)
+{
 	pa_t *pa = (pa_t *)userdata;
 
-	if (!eol && info) {
-		if (info->index != pa->index) {
-			pa->index = info->index;
-			signal++;
-		}
+	if (!eol && info && pa_update(pa, info->index, &info->volume, info->mute, info->name, info->description))
+		kill(getpid(), SIGRTMIN + PA_SIGNAL);
 
-		volume = (int)(pa_cvolume_max(&info->volume) * 100.0f / PA_VOLUME_NORM + 0.5f);
-		if (volume != pa->volume) {
-			pa->volume = volume;
-			signal++;
-		}
+	pa_threaded_mainloop_signal(pa_loop, 0);
+}
 
-		if (info->mute != pa->mute) {
-			pa->mute = info->mute;
-			signal++;
-		}
+void
+pa_source_info_callback(pa_context *ctx, const pa_source_info *info, int eol, void *userdata)
+{
+	pa_t *pa = (pa_t *)userdata;
 
-		if (pa->name)
-			free(pa->name);
-		pa->name = strdup(info->name);
+	if (!eol && info && pa_update(pa, info->index, &info->volume, info->mute, info->name, info->description))
+		kill(getpid(), SIGRTMIN + PA_SIGNAL);
 
-		if (pa->description)
-			free(pa->description);
-		pa->description = strdup(info->description);
+	pa_threaded_mainloop_signal(pa_loop, 0);
+}
+
+/* bind a device that appeared after startup to the entries naming it */
+static void
+pa_new(struct pa_devices *devices, uint32_t index, const pa_cvolume *cvolume, int mute, const char *name, const char *description)
+{
+	size_t iter = 0;
+	int signal = 0;
+	void *val;
+	pa_t *pa;
+
+	while (reg_next(&devices->names, &iter, &val)) {
+		pa = val;
+		/* a replugged device comes back under a new index */
+		if (pa->sink && !strcmp(pa->sink, name))
+			signal |= pa_update(pa, index, cvolume, mute, name, description);
 	}
 
 	if (signal)
 		kill(getpid(), SIGRTMIN + PA_SIGNAL);
+}
 
-	pa_threaded_mainloop_signal(pa_loop, 0);
+static void
+pa_sink_new_callback(pa_context *ctx, const pa_sink_info *info, int eol, void *userdata)
+{
+	if (!eol && info)
+		pa_new(&pa_sinks, info->index, &info->volume, info->mute, info->name, info->description);
+}
+
+static void
+pa_source_new_callback(pa_context *ctx, const pa_source_info *info, int eol, void *userdata)
+{
+	if (!eol && info)
+		pa_new(&pa_sources, info->index, &info->volume, info->mute, info->name, info->description);
+}
+
+static int
+pa_is_default(const char *device, const char *sink, const char *audio)
+{
+	return !device || !strcmp(device, sink) || !strcmp(device, audio);
+}
+
+static pa_t *
+pa_find(struct pa_devices *devices, const char *device)
+{
+	pa_operation *op;
+	pa_t *pa;
+
+	if (!pa_loop)
+		return NULL;
+
+	pa_threaded_mainloop_lock(pa_loop);
+
+	if (!pa_ready)
+		pa = NULL;
+	else if (!(pa = pa_lookup(devices, device))) {
+		pa = calloc(1, sizeof(pa_t));
+		pa->devices = devices;
+		pa->sink = intern(device);
+		pa->index = PA_INVALID_INDEX;
+		qinit(&pa->volume, pa_volume_levels, LEN(pa_volume_levels), 0);
+
+		reg_put(&devices->names, REG_KEY(device), pa);
+
+		if (devices == &pa_sinks)
+			op = pa_context_get_sink_info_by_name(pa_ctx, pa->sink, pa_sink_info_callback, pa);
+		else
+			op = pa_context_get_source_info_by_name(pa_ctx, pa->sink, pa_source_info_callback, pa);
+		pa_operation_unref(op);
+	}
+
+	pa_threaded_mainloop_unlock(pa_loop);
+
+	return pa;
 }
 
 pa_t *
 pa_find_by_sink(const char *sink)
 {
-	pa_operation *op;
+	if (pa_is_default(sink, "@DEFAULT_SINK@", "@DEFAULT_AUDIO_SINK@"))
+		sink = NULL;
+
+	return pa_find(&pa_sinks, sink);
+}
+
+pa_t *
+pa_find_by_source(const char *source)
+{
+	if (pa_is_default(source, "@DEFAULT_SOURCE@", "@DEFAULT_AUDIO_SOURCE@"))
+		source = NULL;
+
+	return pa_find(&pa_sources, source);
+}
+
+static pa_t *
+pa_bind(struct seg *s, pa_t *pa, int gran)
+{
+	if (pa) {
+		pa_threaded_mainloop_lock(pa_loop);
+		qbind(&pa->volume, gran);
+		pa_threaded_mainloop_unlock(pa_loop);
+	}
+
+	return s->handle = pa;
+}
+
+static pa_t *
+pa_bind_sink(struct seg *s, const char *sink, int gran)
+{
+	return s->handle ? s->handle : pa_bind(s, pa_find_by_sink(sink), gran);
+}
+
+static pa_t *
+pa_bind_source(struct seg *s, const char *source, int gran)
+{
+	return s->handle ? s->handle : pa_bind(s, pa_find_by_source(source), gran);
+}
+
+void
+pa_devices_clear(struct pa_devices *devices)
+{
+	size_t iter = 0;
+	void *val;
 	pa_t *pa;
 
-	TAILQ_FOREACH(pa, &pa_queue, entry)
-		if ((!sink && !pa->sink) || (sink && !strcmp(pa->sink, sink)))
-			return pa;
+	while (reg_next(&devices->names, &iter, &val)) {
+		pa = val;
+
+		if (pa->name) {
+			free(pa->name);
+			pa->name = NULL;
+		}
+
+		if (pa->description) {
+			free(pa->description);
+			pa->description = NULL;
+		}
 
-	pa = calloc(1, sizeof(pa_t));
+		free(pa);
+	}
 
-	if (!sink || !strcmp(sink, "@DEFAULT_SINK@") || !strcmp(sink, "@DEFAULT_AUDIO_SINK@"))
-		pa->sink = NULL;
-	else
-		pa->sink = strdup(sink);
+	reg_free(&devices->names);
+	reg_free(&devices->indices);
+}
 
-	op = pa_context_get_sink_info_by_name(pa_ctx, pa->sink, pa_sink_info_callback, pa);
-	pa_operation_unref(op);
+static int
+pa_streams_update(struct registry *streams, uint32_t index, uint32_t device, int corked, pa_proplist *props)
+{
+	const char *app;
+	int signal = 0;
+	pa_stream_t *stream;
+	void *val;
+
+	if (reg_get(streams, index, &val)) {
+		stream = val;
+	} else {
+		stream = calloc(1, sizeof(pa_stream_t));
+		stream->index = index;
+		stream->device = PA_INVALID_INDEX;
+		stream->corked = 1;
+
+		reg_put(streams, index, stream);
+	}
 
-	TAILQ_INSERT_TAIL(&pa_queue, pa, entry);
+	if (device != stream->device) {
+		stream->device = device;
+		signal++;
+	}
 
-	return pa;
+	if (corked != stream->corked) {
+		stream->corked = corked;
+		signal++;
+	}
+
+	if (!(app = pa_proplist_gets(props, PA_PROP_APPLICATION_NAME)))
+		app = pa_proplist_gets(props, PA_PROP_MEDIA_NAME);
+	if (app && (!stream->app || strcmp(stream->app, app))) {
+		free(stream->app);
+		stream->app = strdup(app);
+		signal++;
+	}
+
+	return signal;
+}
+
+static int
+pa_streams_remove(struct registry *streams, uint32_t index)
+{
+	pa_stream_t *stream;
+	void *val;
+
+	if (!reg_get(streams, index, &val))
+		return 0;
+
+	reg_del(streams, index);
+
+	stream = val;
+	free(stream->app);
+	free(stream);
+
+	return 1;
+}
+
+static void
+pa_streams_clear(struct registry *streams)
+{
+	size_t iter = 0;
+	pa_stream_t *stream;
+	void *val;
+
+	while (reg_next(streams, &iter, &val)) {
+		stream = val;
+		free(stream->app);
+		free(stream);
+	}
+
+	reg_free(streams);
+}
+
+void
+pa_sink_input_callback(pa_context *ctx, const pa_sink_input_info *info, int eol, void *userdata)
+{
+	if (!eol && info && pa_streams_update(&pa_inputs, info->index, info->sink, info->corked, info->proplist))
+		kill(getpid(), SIGRTMIN + PA_SIGNAL);
+}
+
+void
+pa_source_output_callback(pa_context *ctx, const pa_source_output_info *info, int eol, void *userdata)
+{
+	if (!eol && info && pa_streams_update(&pa_outputs, info->index, info->source, info->corked, info->proplist))
+		kill(getpid(), SIGRTMIN + PA_SIGNAL);
 }
 
 void
@@ -116,34 +404,80 @@ server_info_callback(pa_context *ctx, const pa_server_info *info, void *userdata
 	pa_operation *op;
 	pa_t *pa;
 
-	if (pa_default_sink && !strcmp(info->default_sink_name, pa_default_sink))
-		return;
-
-	if (pa_default_sink)
+	if (info->default_sink_name &&
+			(!pa_default_sink || strcmp(info->default_sink_name, pa_default_sink))) {
 		free(pa_default_sink);
-	pa_default_sink = strdup(info->default_sink_name);
+		pa_default_sink = strdup(info->default_sink_name);
 
-	pa = pa_find_by_sink(NULL);
-	if (pa) {
-		op = pa_context_get_sink_info_by_name(ctx, pa_default_sink, pa_sink_info_callback, pa);
-		pa_operation_unref(op);
+		if ((pa = pa_lookup(&pa_sinks, NULL))) {
+			op = pa_context_get_sink_info_by_name(ctx, pa_default_sink, pa_sink_info_callback, pa);
+			pa_operation_unref(op);
+		}
+	}
+
+	if (info->default_source_name &&
+			(!pa_default_source || strcmp(info->default_source_name, pa_default_source))) {
+		free(pa_default_source);
+		pa_default_source = strdup(info->default_source_name);
+
+		if ((pa = pa_lookup(&pa_sources, NULL))) {
+			op = pa_context_get_source_info_by_name(ctx, pa_default_source, pa_source_info_callback, pa);
+			pa_operation_unref(op);
+		}
 	}
 }
 
 void
 pa_subscribe_callback(pa_context *ctx, pa_subscription_event_type_t type, uint32_t idx, void *userdata)
 {
-	pa_operation *op;
+	int removed, added;
+	pa_operation *op = NULL;
 	pa_t *pa;
 
-	if ((unsigned int)(type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) == PA_SUBSCRIPTION_EVENT_SINK) {
-		pa = pa_find_by_index(idx);
-		if (pa) {
-			op = pa_context_get_sink_info_by_index(ctx, idx, pa_sink_info_callback, pa);
-			pa_operation_unref(op);
-		} else
-			pa_context_get_server_info(ctx, server_info_callback, userdata);
+	removed = (type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE;
+	added = (type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_NEW;
+
+	switch (type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+	case PA_SUBSCRIPTION_EVENT_SINK:
+		if (removed || !(pa = pa_find_by_index(&pa_sinks, idx))) {
+			/* the server info only covers the default sink */
+			if (added)
+				pa_operation_unref(pa_context_get_sink_info_by_index(ctx, idx, pa_sink_new_callback, NULL));
+			op = pa_context_get_server_info(ctx, server_info_callback, userdata);
+			break;
+		}
+		for (; pa; pa = pa->link)
+			pa_operation_unref(pa_context_get_sink_info_by_index(ctx, idx, pa_sink_info_callback, pa));
+		break;
+	case PA_SUBSCRIPTION_EVENT_SOURCE:
+		if (removed || !(pa = pa_find_by_index(&pa_sources, idx))) {
+			if (added)
+				pa_operation_unref(pa_context_get_source_info_by_index(ctx, idx, pa_source_new_callback, NULL));
+			op = pa_context_get_server_info(ctx, server_info_callback, userdata);
+			break;
+		}
+		for (; pa; pa = pa->link)
+			pa_operation_unref(pa_context_get_source_info_by_index(ctx, idx, pa_source_info_callback, pa));
+		break;
+	case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+		if (!removed)
+			op = pa_context_get_sink_input_info(ctx, idx, pa_sink_input_callback, NULL);
+		else if (pa_streams_remove(&pa_inputs, idx))
+			kill(getpid(), SIGRTMIN + PA_SIGNAL);
+		break;
+	case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+		if (!removed)
+			op = pa_context_get_source_output_info(ctx, idx, pa_source_output_callback, NULL);
+		else if (pa_streams_remove(&pa_outputs, idx))
+			kill(getpid(), SIGRTMIN + PA_SIGNAL);
+		break;
+	case PA_SUBSCRIPTION_EVENT_SERVER:
+		op = pa_context_get_server_info(ctx, server_info_callback, userdata);
+		break;
 	}
+
+	if (op)
+		pa_operation_unref(op);
 }
 
 void
@@ -152,13 +486,28 @@ pa_state_callback(pa_context *ctx, void *userdata)
 	switch (pa_context_get_state(ctx)) {
 		case PA_CONTEXT_READY:
 			pa_context_set_subscribe_callback(ctx, pa_subscribe_callback, userdata);
-			pa_context_subscribe(ctx, PA_SUBSCRIPTION_MASK_SINK, NULL, NULL);
-			pa_context_get_server_info(ctx, server_info_callback, userdata);
-			__attribute__ ((fallthrough));
+			pa_context_subscribe(
+					ctx,
+					PA_SUBSCRIPTION_MASK_SINK |
+					PA_SUBSCRIPTION_MASK_SOURCE |
+					PA_SUBSCRIPTION_MASK_SINK_INPUT |
+					PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT |
+					PA_SUBSCRIPTION_MASK_SERVER,
+					NULL,
+					NULL);
+			pa_operation_unref(pa_context_get_server_info(ctx, server_info_callback, userdata));
+			pa_operation_unref(pa_context_get_sink_input_info_list(ctx, pa_sink_input_callback, NULL));
+			pa_operation_unref(pa_context_get_source_output_info_list(ctx, pa_source_output_callback, NULL));
+
+			pa_ready = 1;
+			trace("pa", 1);
+			kill(getpid(), SIGRTMIN + PA_SIGNAL);
+			break;
 		case PA_CONTEXT_TERMINATED:
 		case PA_CONTEXT_FAILED:
-			pa_state_callback_signal = 1;
-			pa_threaded_mainloop_signal(pa_loop, 0);
+			if (!pa_ready)
+				trace("pa", 0);
+			pa_ready = 0;
 			break;
 		default:
 			break;
@@ -168,156 +517,239 @@ pa_state_callback(pa_context *ctx, void *userdata)
 void
 pa_init(void)
 {
-	TAILQ_INIT(&pa_queue);
-
 	pa_loop = pa_threaded_mainloop_new();
 	if (!pa_loop)
 		return;
 
-	pa_threaded_mainloop_lock(pa_loop);
-
 	pa_ctx = pa_context_new(pa_threaded_mainloop_get_api(pa_loop), "slstatus");
 	if (!pa_ctx) {
-		pa_threaded_mainloop_unlock(pa_loop);
 		pa_threaded_mainloop_free(pa_loop);
 		pa_loop = NULL;
+		trace("pa", 0);
 
 		return;
 	}
 
 	pa_context_set_state_callback(pa_ctx, pa_state_callback, NULL);
 
-	if (pa_context_connect(pa_ctx, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
+	/* segments stay blank until the state callback sees READY */
+	if (pa_context_connect(pa_ctx, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0 ||
+			pa_threaded_mainloop_start(pa_loop) < 0) {
 		pa_context_disconnect(pa_ctx);
 		pa_context_unref(pa_ctx);
 		pa_ctx = NULL;
 
-		pa_threaded_mainloop_unlock(pa_loop);
 		pa_threaded_mainloop_free(pa_loop);
 		pa_loop = NULL;
+		trace("pa", 0);
 
 		return;
 	}
+}
 
-	if (pa_threaded_mainloop_start(pa_loop) < 0) {
+void
+pa_free(void)
+{
+	if (pa_loop) {
+		pa_threaded_mainloop_stop(pa_loop);
 		pa_context_disconnect(pa_ctx);
 		pa_context_unref(pa_ctx);
 		pa_ctx = NULL;
-
-		pa_threaded_mainloop_unlock(pa_loop);
 		pa_threaded_mainloop_free(pa_loop);
 		pa_loop = NULL;
-
-		return;
 	}
 
-	while (!pa_state_callback_signal)
-		pa_threaded_mainloop_wait(pa_loop);
-
-	if (pa_context_get_state(pa_ctx) != PA_CONTEXT_READY) {
-		pa_context_disconnect(pa_ctx);
-		pa_context_unref(pa_ctx);
-		pa_ctx = NULL;
-
-		pa_threaded_mainloop_unlock(pa_loop);
-		pa_threaded_mainloop_stop(pa_loop);
-		pa_threaded_mainloop_free(pa_loop);
-		pa_loop = NULL;
+	pa_devices_clear(&pa_sinks);
+	pa_devices_clear(&pa_sources);
+	pa_streams_clear(&pa_inputs);
+	pa_streams_clear(&pa_outputs);
 
-		return;
+	if (pa_default_sink) {
+		free(pa_default_sink);
+		pa_default_sink = NULL;
 	}
 
-	pa_threaded_mainloop_unlock(pa_loop);
+	if (pa_default_source) {
+		free(pa_default_source);
+		pa_default_source = NULL;
+	}
 }
 
-void
-pa_tick(void)
+/* copy of a string the mainloop thread replaces, into the segment */
+static const char *
+pa_text(struct seg *s, pa_t *pa, int description)
 {
+	const char *str;
+	size_t len = 0;
+
+	pa_threaded_mainloop_lock(pa_loop);
+	str = description ? pa->description : pa->name;
+	if (str) {
+		len = strnlen(str, s->size - 1);
+		memcpy(s->buf, str, len);
+	}
+	s->buf[len] = '\0';
+	pa_threaded_mainloop_unlock(pa_loop);
+
+	return len ? s->buf : NULL;
 }
 
-void
-pa_free(void)
+const char *
+pa_line(struct seg *s, const char *sink)
 {
+	const char *icon;
 	pa_t *pa;
 
-	while ((pa = TAILQ_FIRST(&pa_queue))) {
-		TAILQ_REMOVE(&pa_queue, pa, entry);
+	pa = pa_bind_sink(s, sink, GRAN_VALUE);
+	if (!pa)
+		return NULL;
 
-		if (pa->sink) {
-			free(pa->sink);
-			pa->sink = NULL;
-		}
+	if (pa->mute)
+		icon = "󰖁";
+	else
+		icon = pa_volume_icons[pa->volume.level];
 
-		if (pa->name) {
-			free(pa->name);
-			pa->name = NULL;
-		}
+	return vicon(s, icon, pa->volume.val);
+}
 
-		if (pa->description) {
-			free(pa->description);
-			pa->description = NULL;
-		}
+const char *
+pa_description(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_NONE);
+	return pa ? pa_text(s, pa, 1) : NULL;
+}
 
-		free(pa);
-	}
+const char *
+pa_mute(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_NONE);
+	return pa ? (pa->mute ? "+" : "-") : NULL;
+}
 
-	if (pa_loop) {
-		pa_threaded_mainloop_stop(pa_loop);
-		pa_threaded_mainloop_free(pa_loop);
-	}
+const char *
+pa_name(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_NONE);
+	return pa ? pa_text(s, pa, 0) : NULL;
+}
 
-	if (pa_default_sink) {
-		free(pa_default_sink);
-		pa_default_sink = NULL;
-	}
+const char *
+pa_perc(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_VALUE);
+	return pa ? vnum(s, VAL_PERC, pa->volume.val) : NULL;
 }
 
 const char *
-pa_line(const char *sink)
+pa_source_line(struct seg *s, const char *source)
 {
-	char *icon;
 	pa_t *pa;
 
-	pa = pa_find_by_sink(sink);
+	pa = pa_bind_source(s, source, GRAN_VALUE);
 	if (!pa)
 		return NULL;
 
-	if (pa->mute)
-		icon = "󰖁";
-	else if (pa->volume < 34)
-		icon = "󰕿";
-	else if (pa->volume < 67)
-		icon = "󰖀";
-	else
-		icon = "󰕾";
-
-	return bprintf("%s %d%%", icon, pa->volume);
+	return vicon(s, pa->mute ? "󰍭" : "󰍬", pa->volume.val);
 }
 
 const char *
-pa_description(const char *sink)
+pa_source_description(struct seg *s, const char *source)
 {
-	pa_t *pa = pa_find_by_sink(sink);
-	return pa ? pa->description : NULL;
+	pa_t *pa = pa_bind_source(s, source, GRAN_NONE);
+	return pa ? pa_text(s, pa, 1) : NULL;
 }
 
 const char *
-pa_mute(const char *sink)
+pa_source_mute(struct seg *s, const char *source)
 {
-	pa_t *pa = pa_find_by_sink(sink);
+	pa_t *pa = pa_bind_source(s, source, GRAN_NONE);
 	return pa ? (pa->mute ? "+" : "-") : NULL;
 }
 
 const char *
-pa_name(const char *sink)
+pa_source_name(struct seg *s, const char *source)
+{
+	pa_t *pa = pa_bind_source(s, source, GRAN_NONE);
+	return pa ? pa_text(s, pa, 0) : NULL;
+}
+
+const char *
+pa_source_perc(struct seg *s, const char *source)
+{
+	pa_t *pa = pa_bind_source(s, source, GRAN_VALUE);
+	return pa ? vnum(s, VAL_PERC, pa->volume.val) : NULL;
+}
+
+static int
+pa_streams_active(struct registry *streams, uint32_t device)
+{
+	int active = 0;
+	size_t iter = 0;
+	pa_stream_t *stream;
+	void *val;
+
+	pa_threaded_mainloop_lock(pa_loop);
+	while (!active && reg_next(streams, &iter, &val)) {
+		stream = val;
+		active = !stream->corked && stream->device == device;
+	}
+	pa_threaded_mainloop_unlock(pa_loop);
+
+	return active;
+}
+
+static const char *
+pa_streams_apps(struct seg *s, struct registry *streams, uint32_t device)
+{
+	int len;
+	size_t iter = 0, n = 0;
+	pa_stream_t *stream;
+	void *val;
+
+	s->buf[0] = '\0';
+	pa_threaded_mainloop_lock(pa_loop);
+	while (reg_next(streams, &iter, &val)) {
+		stream = val;
+		if (stream->corked || stream->device != device || !stream->app)
+			continue;
+
+		len = snprintf(s->buf + n, s->size - n, "%s%s", n ? ", " : "", stream->app);
+		if (len < 0 || (size_t)len >= s->size - n) {
+			s->buf[n] = '\0';
+			break;
+		}
+		n += len;
+	}
+	pa_threaded_mainloop_unlock(pa_loop);
+
+	return n ? s->buf : NULL;
+}
+
+const char *
+pa_playing(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_NONE);
+	return (pa && pa_streams_active(&pa_inputs, pa->index)) ? "󰝚" : NULL;
+}
+
+const char *
+pa_playing_apps(struct seg *s, const char *sink)
+{
+	pa_t *pa = pa_bind_sink(s, sink, GRAN_NONE);
+	return pa ? pa_streams_apps(s, &pa_inputs, pa->index) : NULL;
+}
+
+const char *
+pa_recording(struct seg *s, const char *source)
 {
-	pa_t *pa = pa_find_by_sink(sink);
-	return pa ? pa->name : NULL;
+	pa_t *pa = pa_bind_source(s, source, GRAN_NONE);
+	return (pa && pa_streams_active(&pa_outputs, pa->index)) ? "󰍬" : NULL;
 }
 
 const char *
-pa_perc(const char *sink)
+pa_recording_apps(struct seg *s, const char *source)
 {
-	pa_t *pa = pa_find_by_sink(sink);
-	return pa ? bprintf("%d", pa->volume) : NULL;
+	pa_t *pa = pa_bind_source(s, source, GRAN_NONE);
+	return pa ? pa_streams_apps(s, &pa_outputs, pa->index) : NULL;
 }
+#endif
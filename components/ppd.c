@@ -1,74 +1,222 @@
+#include "../slstatus.h"
+
+#ifdef USE_PPD
 #include <gio/gio.h>
 #include <glib.h>
+#include <stdio.h>
 
-#include "../slstatus.h"
+#include "../bus.h"
+#include "../registry.h"
+#include "../util.h"
+
+#define PPD_NAME "org.freedesktop.UPower.PowerProfiles"
+#define PPD_PATH "/org/freedesktop/UPower/PowerProfiles"
+/* upper bound for any call, a wedged daemon must not stall the bar */
+#define PPD_TIMEOUT 1000
 
 GDBusProxy *ppd_proxy = NULL;
-gchar *ppd_profile = NULL;
+GCancellable *ppd_cancellable = NULL;
+char ppd_profile[32];
+char ppd_degraded_reason[64];
+char ppd_hold_apps[128];
+/* the daemon has PerformanceDegraded, PerformanceInhibited is stale */
+int ppd_has_degraded = 0;
 
-void
-ppd_update(GDBusProxy *proxy)
+static int
+ppd_copy(char *dst, size_t size, const char *src)
 {
-	gchar *profile = NULL;
-	GVariant *tuple, *value;
+	if (!strncmp(dst, src, size - 1))
+		return 0;
 
-	tuple = g_dbus_proxy_call_sync(
-			proxy,
-			"Get",
-			g_variant_new("(ss)", "org.freedesktop.UPower.PowerProfiles", "ActiveProfile"),
-			G_DBUS_CALL_FLAGS_NONE,
-			-1,
-			NULL,
-			NULL);
-	if (tuple) {
-		g_variant_get(tuple, "(v)", &value);
-		profile = g_variant_dup_string(value, NULL);
-		g_variant_unref(value);
-		g_variant_unref(tuple);
+	snprintf(dst, size, "%s", src);
+	return 1;
+}
 
-		if ((profile != ppd_profile) || (ppd_profile && strcmp(profile, ppd_profile))) {
-			if (ppd_profile)
-				free(ppd_profile);
-			ppd_profile = profile;
-			kill(getpid(), SIGRTMIN + PPD_SIGNAL);
+/* application ids of the profile holds, comma separated */
+static int
+ppd_set_holds(GVariant *holds)
+{
+	GVariantIter *iter;
+	GVariant *hold;
+	const char *app;
+	char list[sizeof(ppd_hold_apps)];
+	size_t n = 0;
+	int len;
+
+	list[0] = '\0';
+	iter = g_variant_iter_new(holds);
+	while (g_variant_iter_next(iter, "@a{sv}", &hold)) {
+		if (g_variant_lookup(hold, "ApplicationId", "&s", &app)) {
+			len = snprintf(list + n, sizeof(list) - n, "%s%s", n ? ", " : "", app);
+			if (len < 0 || (size_t)len >= sizeof(list) - n)
+				list[n] = '\0';
+			else
+				n += len;
 		}
+		g_variant_unref(hold);
 	}
+	g_variant_iter_free(iter);
+
+	return ppd_copy(ppd_hold_apps, sizeof(ppd_hold_apps), list);
 }
 
-void
-ppd_callback(GDBusProxy *proxy, gchar *sender, gchar *signal, GVariant *parameters, gpointer user_data)
+/* apply one property, NULL value clears it */
+static int
+ppd_set(const char *name, GVariant *value)
 {
-	ppd_update(proxy);
+	if (!strcmp(name, "ActiveProfile"))
+		return ppd_copy(ppd_profile, sizeof(ppd_profile), value ? g_variant_get_string(value, NULL) : "");
+	if (!strcmp(name, "PerformanceDegraded")) {
+		ppd_has_degraded = value != NULL;
+		return ppd_copy(ppd_degraded_reason, sizeof(ppd_degraded_reason), value ? g_variant_get_string(value, NULL) : "");
+	}
+	/*
+	 * renamed to PerformanceDegraded in power-profiles-daemon 0.10, which
+	 * still sends the old one, always empty
+	 */
+	if (!strcmp(name, "PerformanceInhibited")) {
+		if (ppd_has_degraded)
+			return 0;
+		return ppd_copy(ppd_degraded_reason, sizeof(ppd_degraded_reason), value ? g_variant_get_string(value, NULL) : "");
+	}
+	if (!strcmp(name, "ActiveProfileHolds"))
+		return value ? ppd_set_holds(value) : ppd_copy(ppd_hold_apps, sizeof(ppd_hold_apps), "");
+
+	return 0;
 }
 
-void
-ppd_init(void)
+static void
+ppd_get_callback(GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	ppd_proxy = g_dbus_proxy_new_for_bus_sync(
-			G_BUS_TYPE_SYSTEM,
-			G_DBUS_PROXY_FLAGS_NONE,
-			NULL,
-			"org.freedesktop.UPower.PowerProfiles",
-			"/org/freedesktop/UPower/PowerProfiles",
-			"org.freedesktop.DBus.Properties",
-			NULL,
-			NULL);
+	GVariant *tuple, *value;
+	const char *name = user_data;
+
+	tuple = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), res, NULL);
+	if (!tuple)
+		return;
+
+	g_variant_get(tuple, "(v)", &value);
+	if (ppd_set(name, value))
+		kill(getpid(), SIGRTMIN + PPD_SIGNAL);
+
+	g_variant_unref(value);
+	g_variant_unref(tuple);
+}
+
+/* fetch a property the daemon only invalidated instead of sending */
+static void
+ppd_get(const char *name)
+{
+	g_dbus_proxy_call(
+			ppd_proxy,
+			"org.freedesktop.DBus.Properties.Get",
+			g_variant_new("(ss)", PPD_NAME, name),
+			G_DBUS_CALL_FLAGS_NONE,
+			PPD_TIMEOUT,
+			ppd_cancellable,
+			ppd_get_callback,
+			(gpointer)name);
+}
+
+static void
+ppd_properties_callback(GDBusProxy *proxy, GVariant *changed, const gchar *const *invalidated, gpointer user_data)
+{
+	GVariantIter *iter;
+	GVariant *value;
+	const char *name;
+	gchar *owner;
+	int signal = 0;
+	size_t i;
+
+	/* before PerformanceInhibited, whatever order the payload has */
+	if ((value = g_variant_lookup_value(changed, "PerformanceDegraded", NULL))) {
+		signal |= ppd_set("PerformanceDegraded", value);
+		g_variant_unref(value);
+	}
+
+	iter = g_variant_iter_new(changed);
+	while (g_variant_iter_next(iter, "{&sv}", &name, &value)) {
+		signal |= ppd_set(name, value);
+		g_variant_unref(value);
+	}
+	g_variant_iter_free(iter);
+
+	/* the daemon going away invalidates everything */
+	owner = g_dbus_proxy_get_name_owner(proxy);
+	for (i = 0; invalidated && invalidated[i]; i++) {
+		if (owner)
+			ppd_get(intern(invalidated[i]));
+		else
+			signal |= ppd_set(invalidated[i], NULL);
+	}
+	g_free(owner);
+
+	if (signal)
+		kill(getpid(), SIGRTMIN + PPD_SIGNAL);
+}
+
+static void
+ppd_proxy_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	static const char *names[] = {
+		"ActiveProfile", "ActiveProfileHolds",
+		/* PerformanceDegraded first, it decides on PerformanceInhibited */
+		"PerformanceDegraded", "PerformanceInhibited",
+	};
+	GVariant *value;
+	int signal = 0;
+	size_t i;
+
+	ppd_proxy = g_dbus_proxy_new_finish(res, NULL);
+	trace("ppd", ppd_proxy != NULL);
 	if (!ppd_proxy)
 		return;
 
-	ppd_update(ppd_proxy);
-	g_signal_connect(ppd_proxy, "g-signal", G_CALLBACK(ppd_callback), NULL);
+	g_signal_connect(ppd_proxy, "g-properties-changed", G_CALLBACK(ppd_properties_callback), NULL);
+
+	/* initial values come with the proxy's property cache */
+	for (i = 0; i < LEN(names); i++) {
+		if (!(value = g_dbus_proxy_get_cached_property(ppd_proxy, names[i])))
+			continue;
+		signal |= ppd_set(names[i], value);
+		g_variant_unref(value);
+	}
+
+	if (signal)
+		kill(getpid(), SIGRTMIN + PPD_SIGNAL);
 }
 
 void
-ppd_tick(void)
+ppd_init(void)
 {
-	while (g_main_context_iteration(NULL, FALSE));
+	if (!bus_conn) {
+		trace("ppd", 0);
+		return;
+	}
+
+	ppd_cancellable = g_cancellable_new();
+
+	g_dbus_proxy_new(
+			bus_conn,
+			G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+			NULL,
+			PPD_NAME,
+			PPD_PATH,
+			PPD_NAME,
+			ppd_cancellable,
+			ppd_proxy_callback,
+			NULL);
 }
 
 void
 ppd_free(void)
 {
+	if (ppd_cancellable) {
+		g_cancellable_cancel(ppd_cancellable);
+		g_object_unref(ppd_cancellable);
+		ppd_cancellable = NULL;
+	}
+
 	if (ppd_proxy) {
 		g_object_unref(ppd_proxy);
 		ppd_proxy = NULL;
@@ -76,9 +224,9 @@ ppd_free(void)
 }
 
 const char *
-ppd_line(const char *unused)
+ppd_line(struct seg *s, const char *unused)
 {
-	if (!ppd_profile)
+	if (!ppd_profile[0])
 		return NULL;
 
 	if (!strcmp(ppd_profile, "power-saver"))
@@ -90,7 +238,20 @@ ppd_line(const char *unused)
 }
 
 const char *
-ppd_active(const char *unused)
+ppd_active(struct seg *s, const char *unused)
+{
+	return ppd_profile[0] ? ppd_profile : NULL;
+}
+
+const char *
+ppd_holds(struct seg *s, const char *unused)
+{
+	return ppd_hold_apps[0] ? ppd_hold_apps : NULL;
+}
+
+const char *
+ppd_degraded(struct seg *s, const char *unused)
 {
-	return ppd_profile;
+	return ppd_degraded_reason[0] ? ppd_degraded_reason : NULL;
 }
+#endif
@@ -7,71 +7,73 @@
 #if defined(__linux__)
 	#include <stdint.h>
 
+	#define MEMINFO "/proc/meminfo"
+
 	const char *
-	ram_free(const char *unused)
+	ram_free(struct seg *s, const char *unused)
 	{
 		uintmax_t free;
 
-		if (pscanf("/proc/meminfo",
-		           "MemTotal: %ju kB\n"
-		           "MemFree: %ju kB\n"
-		           "MemAvailable: %ju kB\n",
-		           &free, &free, &free) != 3)
+		if (pfscanf(segfile(s, MEMINFO, NULL),
+		            "MemTotal: %ju kB\n"
+		            "MemFree: %ju kB\n"
+		            "MemAvailable: %ju kB\n",
+		            &free, &free, &free) != 3)
 			return NULL;
 
-		return fmt_human(free * 1024, 1024);
+		return vnum(s, VAL_BYTES, free * 1024);
 	}
 
 	const char *
-	ram_perc(const char *unused)
+	ram_perc(struct seg *s, const char *unused)
 	{
 		uintmax_t total, free, buffers, cached;
 		int percent;
 
-		if (pscanf("/proc/meminfo",
-		           "MemTotal: %ju kB\n"
-		           "MemFree: %ju kB\n"
-		           "MemAvailable: %ju kB\n"
-		           "Buffers: %ju kB\n"
-		           "Cached: %ju kB\n",
-		           &total, &free, &buffers, &buffers, &cached) != 5)
+		if (pfscanf(segfile(s, MEMINFO, NULL),
+		            "MemTotal: %ju kB\n"
+		            "MemFree: %ju kB\n"
+		            "MemAvailable: %ju kB\n"
+		            "Buffers: %ju kB\n"
+		            "Cached: %ju kB\n",
+		            &total, &free, &buffers, &buffers, &cached) != 5)
 			return NULL;
 
 		if (total == 0)
 			return NULL;
 
 		percent = 100 * ((total - free) - (buffers + cached)) / total;
-		return bprintf("%d", percent);
+		return vnum(s, VAL_PERC, percent);
 	}
 
 	const char *
-	ram_total(const char *unused)
+	ram_total(struct seg *s, const char *unused)
 	{
 		uintmax_t total;
 
-		if (pscanf("/proc/meminfo", "MemTotal: %ju kB\n", &total)
-		    != 1)
+		if (pfscanf(segfile(s, MEMINFO, NULL), "MemTotal: %ju kB\n",
+		            &total) != 1)
 			return NULL;
 
-		return fmt_human(total * 1024, 1024);
+		return vnum(s, VAL_BYTES, total * 1024);
 	}
 
 	const char *
-	ram_used(const char *unused)
+	ram_used(struct seg *s, const char *unused)
 	{
 		uintmax_t total, free, buffers, cached, used;
 
-		if (pscanf("/proc/meminfo",
-		           "MemTotal: %ju kB\n"
-		           "MemFree: %ju kB\n"
-		           "MemAvailable: %ju kB\n"
-		           "Buffers: %ju kB\n"
-		           "Cached: %ju kB\n",
-		           &total, &free, &buffers, &buffers, &cached) != 5)
+		if (pfscanf(segfile(s, MEMINFO, NULL),
+		            "MemTotal: %ju kB\n"
+		            "MemFree: %ju kB\n"
+		            "MemAvailable: %ju kB\n"
+		            "Buffers: %ju kB\n"
+		            "Cached: %ju kB\n",
+		            &total, &free, &buffers, &buffers, &cached) != 5)
 			return NULL;
 
 		used = (total - free - buffers - cached);
-		return fmt_human(used * 1024, 1024);
+		return vnum(s, VAL_BYTES, used * 1024);
 	}
 #elif defined(__OpenBSD__)
 	#include <stdlib.h>
@@ -97,7 +99,7 @@
 	}
 
 	const char *
-	ram_free(const char *unused)
+	ram_free(struct seg *s, const char *unused)
 	{
 		struct uvmexp uvmexp;
 		int free_pages;
@@ -106,12 +108,12 @@
 			return NULL;
 
 		free_pages = uvmexp.npages - uvmexp.active;
-		return fmt_human(pagetok(free_pages, uvmexp.pageshift) *
-				 1024, 1024);
+		return vnum(s, VAL_BYTES, pagetok(free_pages, uvmexp.pageshift) *
+				 1024);
 	}
 
 	const char *
-	ram_perc(const char *unused)
+	ram_perc(struct seg *s, const char *unused)
 	{
 		struct uvmexp uvmexp;
 		int percent;
@@ -120,31 +122,31 @@
 			return NULL;
 
 		percent = uvmexp.active * 100 / uvmexp.npages;
-		return bprintf("%d", percent);
+		return vnum(s, VAL_PERC, percent);
 	}
 
 	const char *
-	ram_total(const char *unused)
+	ram_total(struct seg *s, const char *unused)
 	{
 		struct uvmexp uvmexp;
 
 		if (!load_uvmexp(&uvmexp))
 			return NULL;
 
-		return fmt_human(pagetok(uvmexp.npages,
-					 uvmexp.pageshift) * 1024, 1024);
+		return vnum(s, VAL_BYTES, pagetok(uvmexp.npages,
+					 uvmexp.pageshift) * 1024);
 	}
 
 	const char *
-	ram_used(const char *unused)
+	ram_used(struct seg *s, const char *unused)
 	{
 		struct uvmexp uvmexp;
 
 		if (!load_uvmexp(&uvmexp))
 			return NULL;
 
-		return fmt_human(pagetok(uvmexp.active,
-					 uvmexp.pageshift) * 1024, 1024);
+		return vnum(s, VAL_BYTES, pagetok(uvmexp.active,
+					 uvmexp.pageshift) * 1024);
 	}
 #elif defined(__FreeBSD__)
 	#include <sys/sysctl.h>
@@ -153,7 +155,7 @@
 	#include <vm/vm_param.h>
 
 	const char *
-	ram_free(const char *unused) {
+	ram_free(struct seg *s, const char *unused) {
 		struct vmtotal vm_stats;
 		int mib[] = {CTL_VM, VM_TOTAL};
 		size_t len;
@@ -163,11 +165,11 @@
 		    || !len)
 			return NULL;
 
-		return fmt_human(vm_stats.t_free * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, vm_stats.t_free * getpagesize());
 	}
 
 	const char *
-	ram_total(const char *unused) {
+	ram_total(struct seg *s, const char *unused) {
 		unsigned int npages;
 		size_t len;
 
@@ -176,11 +178,11 @@
 		                 &npages, &len, NULL, 0) < 0 || !len)
 			return NULL;
 
-		return fmt_human(npages * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, npages * getpagesize());
 	}
 
 	const char *
-	ram_perc(const char *unused) {
+	ram_perc(struct seg *s, const char *unused) {
 		unsigned int npages;
 		unsigned int active;
 		size_t len;
@@ -194,11 +196,11 @@
 		                 &active, &len, NULL, 0) < 0 || !len)
 			return NULL;
 
-		return bprintf("%d", active * 100 / npages);
+		return vnum(s, VAL_PERC, active * 100 / npages);
 	}
 
 	const char *
-	ram_used(const char *unused) {
+	ram_used(struct seg *s, const char *unused) {
 		unsigned int active;
 		size_t len;
 
@@ -207,6 +209,6 @@
 		                 &active, &len, NULL, 0) < 0 || !len)
 			return NULL;
 
-		return fmt_human(active * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, active * getpagesize());
 	}
 #endif
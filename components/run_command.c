@@ -6,7 +6,7 @@
 #include "../util.h"
 
 const char *
-run_command(const char *cmd)
+run_command(struct seg *s, const char *cmd)
 {
 	char *p;
 	FILE *fp;
@@ -16,7 +16,7 @@ run_command(const char *cmd)
 		return NULL;
 	}
 
-	p = fgets(buf, sizeof(buf) - 1, fp);
+	p = fgets(s->buf, s->size, fp);
 	if (pclose(fp) < 0) {
 		warn("pclose '%s':", cmd);
 		return NULL;
@@ -24,8 +24,8 @@ run_command(const char *cmd)
 	if (!p)
 		return NULL;
 
-	if ((p = strrchr(buf, '\n')))
+	if ((p = strrchr(s->buf, '\n')))
 		p[0] = '\0';
 
-	return buf[0] ? buf : NULL;
+	return s->buf[0] ? s->buf : NULL;
 }
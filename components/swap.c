@@ -57,47 +57,47 @@
 	}
 
 	const char *
-	swap_free(const char *unused)
+	swap_free(struct seg *s, const char *unused)
 	{
 		long free;
 
 		if (get_swap_info(NULL, &free, NULL))
 			return NULL;
 
-		return fmt_human(free * 1024, 1024);
+		return vnum(s, VAL_BYTES, free * 1024);
 	}
 
 	const char *
-	swap_perc(const char *unused)
+	swap_perc(struct seg *s, const char *unused)
 	{
 		long total, free, cached;
 
 		if (get_swap_info(&total, &free, &cached) || total == 0)
 			return NULL;
 
-		return bprintf("%d", 100 * (total - free - cached) / total);
+		return vnum(s, VAL_PERC, 100 * (total - free - cached) / total);
 	}
 
 	const char *
-	swap_total(const char *unused)
+	swap_total(struct seg *s, const char *unused)
 	{
 		long total;
 
 		if (get_swap_info(&total, NULL, NULL))
 			return NULL;
 
-		return fmt_human(total * 1024, 1024);
+		return vnum(s, VAL_BYTES, total * 1024);
 	}
 
 	const char *
-	swap_used(const char *unused)
+	swap_used(struct seg *s, const char *unused)
 	{
 		long total, free, cached;
 
 		if (get_swap_info(&total, &free, &cached))
 			return NULL;
 
-		return fmt_human((total - free - cached) * 1024, 1024);
+		return vnum(s, VAL_BYTES, (total - free - cached) * 1024);
 	}
 #elif defined(__OpenBSD__)
 	#include <stdlib.h>
@@ -142,18 +142,18 @@
 	}
 
 	const char *
-	swap_free(const char *unused)
+	swap_free(struct seg *s, const char *unused)
 	{
 		int total, used;
 
 		if (getstats(&total, &used))
 			return NULL;
 
-		return fmt_human((total - used) * 1024, 1024);
+		return vnum(s, VAL_BYTES, (total - used) * 1024);
 	}
 
 	const char *
-	swap_perc(const char *unused)
+	swap_perc(struct seg *s, const char *unused)
 	{
 		int total, used;
 
@@ -163,29 +163,29 @@
 		if (total == 0)
 			return NULL;
 
-		return bprintf("%d", 100 * used / total);
+		return vnum(s, VAL_PERC, 100 * used / total);
 	}
 
 	const char *
-	swap_total(const char *unused)
+	swap_total(struct seg *s, const char *unused)
 	{
 		int total, used;
 
 		if (getstats(&total, &used))
 			return NULL;
 
-		return fmt_human(total * 1024, 1024);
+		return vnum(s, VAL_BYTES, total * 1024);
 	}
 
 	const char *
-	swap_used(const char *unused)
+	swap_used(struct seg *s, const char *unused)
 	{
 		int total, used;
 
 		if (getstats(&total, &used))
 			return NULL;
 
-		return fmt_human(used * 1024, 1024);
+		return vnum(s, VAL_BYTES, used * 1024);
 	}
 #elif defined(__FreeBSD__)
 	#include <fcntl.h>
@@ -215,7 +215,7 @@
 	}
 
 	const char *
-	swap_free(const char *unused)
+	swap_free(struct seg *s, const char *unused)
 	{
 		struct kvm_swap swap_info[1];
 		long used, total;
@@ -226,11 +226,11 @@
 		total = swap_info[0].ksw_total;
 		used = swap_info[0].ksw_used;
 
-		return fmt_human((total - used) * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, (total - used) * getpagesize());
 	}
 
 	const char *
-	swap_perc(const char *unused)
+	swap_perc(struct seg *s, const char *unused)
 	{
 		struct kvm_swap swap_info[1];
 		long used, total;
@@ -241,11 +241,11 @@
 		total = swap_info[0].ksw_total;
 		used = swap_info[0].ksw_used;
 
-		return bprintf("%d", used * 100 / total);
+		return vnum(s, VAL_PERC, used * 100 / total);
 	}
 
 	const char *
-	swap_total(const char *unused)
+	swap_total(struct seg *s, const char *unused)
 	{
 		struct kvm_swap swap_info[1];
 		long total;
@@ -255,11 +255,11 @@
 
 		total = swap_info[0].ksw_total;
 
-		return fmt_human(total * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, total * getpagesize());
 	}
 
 	const char *
-	swap_used(const char *unused)
+	swap_used(struct seg *s, const char *unused)
 	{
 		struct kvm_swap swap_info[1];
 		long used;
@@ -269,6 +269,6 @@
 
 		used = swap_info[0].ksw_used;
 
-		return fmt_human(used * getpagesize(), 1024);
+		return vnum(s, VAL_BYTES, used * getpagesize());
 	}
 #endif
@@ -9,14 +9,14 @@
 	#include <stdint.h>
 
 	const char *
-	temp(const char *file)
+	temp(struct seg *s, const char *file)
 	{
 		uintmax_t temp;
 
-		if (pscanf(file, "%ju", &temp) != 1)
+		if (pfscanf(segfile(s, "%s", file), "%ju", &temp) != 1)
 			return NULL;
 
-		return bprintf("%ju", temp / 1000);
+		return vnum(s, VAL_INT, temp / 1000);
 	}
 #elif defined(__OpenBSD__)
 	#include <stdio.h>
@@ -25,7 +25,7 @@
 	#include <sys/sysctl.h>
 
 	const char *
-	temp(const char *unused)
+	temp(struct seg *s, const char *unused)
 	{
 		int mib[5];
 		size_t size;
@@ -45,7 +45,7 @@
 		}
 
 		/* kelvin to celsius */
-		return bprintf("%d", (int)((float)(temp.value-273150000) / 1E6));
+		return bprintf(s, "%d", (int)((float)(temp.value-273150000) / 1E6));
 	}
 #elif defined(__FreeBSD__)
 	#include <stdio.h>
@@ -55,7 +55,7 @@
 	#define ACPI_TEMP "hw.acpi.thermal.%s.temperature"
 
 	const char *
-	temp(const char *zone)
+	temp(struct seg *s, const char *zone)
 	{
 		char buf[256];
 		int temp;
@@ -68,6 +68,6 @@
 			return NULL;
 
 		/* kelvin to decimal celcius */
-		return bprintf("%d.%d", (temp - 2731) / 10, abs((temp - 2731) % 10));
+		return bprintf(s, "%d.%d", (temp - 2731) / 10, abs((temp - 2731) % 10));
 	}
 #endif
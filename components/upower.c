@@ -1,227 +1,388 @@
+#include "../slstatus.h"
+
+#ifdef USE_UPOWER
 #include <upower.h>
 
-#include "../slstatus.h"
-#include "../queue.h"
+#include "../registry.h"
 #include "../util.h"
 
+#define UPOWER_NAME "org.freedesktop.UPower"
+#define UPOWER_DISPLAY_PATH "/org/freedesktop/UPower/devices/DisplayDevice"
+
 typedef struct upower_t {
-	TAILQ_ENTRY(upower_t) entry;
 	const char *device;
+	const char *path;
+	UpDevice *gdevice;
+	gulong percentage_id;
+	gulong state_id;
+	/* the display device, libupower-glib only gets it synchronously */
+	GDBusProxy *proxy;
+	gulong properties_id;
+
 	char *model;
-	gdouble percentage;
+	struct quant perc;
 	UpDeviceKind kind;
 	UpDeviceState state;
 } upower_t;
 
-TAILQ_HEAD(upower_q, upower_t);
-
-struct upower_q upower_queue;
+/* charge steps of the battery icons */
+static const int upower_levels[] = { 5, 15, 25, 35, 45, 55, 65, 75, 85, 95 };
+static const char *upower_discharging_icons[] = {
+	"󰂎", "󰁺", "󰁻", "󰁼", "󰁽", "󰁾", "󰁿", "󰂀", "󰂁", "󰂂", "󰁹",
+};
+static const char *upower_charging_icons[] = {
+	"󰢟", "󰢜", "󰂆", "󰂇", "󰂈", "󰢝", "󰂉", "󰢞", "󰂊", "󰂋", "󰂅",
+};
+
+/* devices by native path, the display device under NULL */
+struct registry upower_registry;
+/* the same devices by D-Bus object path, for device-removed */
+struct registry upower_paths;
+unsigned int upower_gen = 1;
 UpClient *upower_client = NULL;
 
-void
-upower_init(void)
+static void
+upower_percentage_callback(UpDevice *device, GParamSpec *pspec, gpointer user_data)
 {
-	TAILQ_INIT(&upower_queue);
+	gdouble percentage;
+	upower_t *upower = (upower_t *)user_data;
 
-	upower_client = up_client_new();
+	g_object_get(device, "percentage", &percentage, NULL);
+	if (qset(&upower->perc, (int)percentage))
+		kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
 }
 
-void
-upower_tick(void)
+static void
+upower_state_callback(UpDevice *device, GParamSpec *pspec, gpointer user_data)
 {
-	while (g_main_context_iteration(NULL, FALSE));
+	UpDeviceState state;
+	upower_t *upower = (upower_t *)user_data;
+
+	g_object_get(device, "state", &state, NULL);
+	if (state != upower->state) {
+		upower->state = state;
+		kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
+	}
 }
 
-void
-upower_free(void)
+static void
+upower_attach(upower_t *upower, UpDevice *device)
 {
-	upower_t *upower;
+	gdouble percentage;
 
-	while ((upower = TAILQ_FIRST(&upower_queue))) {
-		TAILQ_REMOVE(&upower_queue, upower, entry);
+	if (upower->model)
+		g_free(upower->model);
 
-		if (upower->model) {
-			g_free(upower->model);
-			upower->model = NULL;
-		}
+	g_object_get(
+			device,
+			"kind",
+			&upower->kind,
+			"model",
+			&upower->model,
+			"percentage",
+			&percentage,
+			"state",
+			&upower->state,
+			NULL);
 
-		free(upower);
+	qinit(&upower->perc, upower_levels, LEN(upower_levels), (int)percentage);
+
+	upower->gdevice = g_object_ref(device);
+	upower->path = intern(up_device_get_object_path(device));
+	upower->percentage_id = g_signal_connect(device, "notify::percentage", G_CALLBACK(upower_percentage_callback), upower);
+	upower->state_id = g_signal_connect(device, "notify::state", G_CALLBACK(upower_state_callback), upower);
+
+	reg_put(&upower_paths, (uintptr_t)upower->path, upower);
+
+	kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
+}
+
+static void
+upower_detach(upower_t *upower)
+{
+	if (upower->proxy) {
+		g_signal_handler_disconnect(upower->proxy, upower->properties_id);
+		g_object_unref(upower->proxy);
+		upower->proxy = NULL;
+		upower->properties_id = 0;
+		kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
 	}
 
-	if (upower_client) {
-		g_object_unref(upower_client);
-		upower_client = NULL;
+	if (!upower->gdevice)
+		return;
+
+	g_signal_handler_disconnect(upower->gdevice, upower->percentage_id);
+	g_signal_handler_disconnect(upower->gdevice, upower->state_id);
+	g_object_unref(upower->gdevice);
+
+	reg_del(&upower_paths, (uintptr_t)upower->path);
+
+	upower->gdevice = NULL;
+	upower->percentage_id = upower->state_id = 0;
+
+	kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
+}
+
+/* entry of name, detached from whatever it tracked before */
+static upower_t *
+upower_entry(const char *name)
+{
+	upower_t *upower;
+	uintptr_t key;
+	void *val;
+
+	key = REG_KEY(name);
+	if (reg_get(&upower_registry, key, &val)) {
+		upower = val;
+		upower_detach(upower);
+	} else {
+		if (!(upower = calloc(1, sizeof(upower_t))))
+			die("calloc:");
+		upower->device = intern(name);
+		reg_put(&upower_registry, key, upower);
+
+		/* segments that missed this device may bind now */
+		upower_gen++;
 	}
+
+	return upower;
 }
 
-void
-upower_device_callback(UpDevice *device, GParamSpec *pspec, gpointer user_data)
+static void
+upower_track(UpDevice *device, const char *name)
+{
+	upower_attach(upower_entry(name), device);
+}
+
+/* apply one property of the display device, 1 if it shows differently */
+static int
+upower_display_set(upower_t *upower, const char *name, GVariant *value)
 {
-	const gchar *name;
-	gdouble percentage;
 	UpDeviceState state;
-	upower_t *upower;
 
-	name = g_param_spec_get_name(pspec);
+	if (!strcmp(name, "Percentage"))
+		return qset(&upower->perc, (int)g_variant_get_double(value));
+	if (!strcmp(name, "State")) {
+		state = g_variant_get_uint32(value);
+		if (state == upower->state)
+			return 0;
+		upower->state = state;
+		return 1;
+	}
+	if (!strcmp(name, "Type"))
+		upower->kind = g_variant_get_uint32(value);
+	else if (!strcmp(name, "Model")) {
+		g_free(upower->model);
+		upower->model = g_variant_dup_string(value, NULL);
+	}
 
-	if (!strcmp(name, "percentage")) {
-		upower = (upower_t *)user_data;
-		if (!upower)
-			return;
+	return 0;
+}
 
-		g_object_get(device, "percentage", &percentage, NULL);
-		if (percentage != upower->percentage) {
-			upower->percentage = percentage;
-			kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
-		}
-	} else if (!strcmp(name, "state")) {
-		upower = (upower_t *)user_data;
-		if (!upower)
-			return;
-
-		g_object_get(device, "state", &state, NULL);
-		if (state != upower->state) {
-			upower->state = state;
-			kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
-		}
+static void
+upower_display_properties_callback(GDBusProxy *proxy, GVariant *changed, const gchar *const *invalidated, gpointer user_data)
+{
+	GVariantIter *iter;
+	GVariant *value;
+	const char *name;
+	int signal = 0;
+
+	iter = g_variant_iter_new(changed);
+	while (g_variant_iter_next(iter, "{&sv}", &name, &value)) {
+		signal |= upower_display_set(user_data, name, value);
+		g_variant_unref(value);
 	}
+	g_variant_iter_free(iter);
+
+	if (signal)
+		kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
 }
 
-void
-upower_update_from_device(upower_t *upower, UpDevice *device)
+static void
+upower_display_callback(GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	if (upower->model)
-		g_free(upower->model);
+	static const char *names[] = { "Type", "Model", "State" };
+	GDBusProxy *proxy;
+	GVariant *value;
+	upower_t *upower;
+	size_t i;
 
-	g_object_get(
-			device,
-			"kind",
-			&upower->kind,
-			"model",
-			&upower->model,
-			"percentage",
-			&upower->percentage,
-			"state",
-			&upower->state,
-			NULL);
+	if (!(proxy = g_dbus_proxy_new_for_bus_finish(res, NULL)))
+		return;
+
+	/* no daemon, or one without a display device */
+	if (!(value = g_dbus_proxy_get_cached_property(proxy, "Percentage"))) {
+		g_object_unref(proxy);
+		return;
+	}
+
+	upower = upower_entry(NULL);
+	qinit(&upower->perc, upower_levels, LEN(upower_levels), (int)g_variant_get_double(value));
+	g_variant_unref(value);
+	for (i = 0; i < LEN(names); i++) {
+		if (!(value = g_dbus_proxy_get_cached_property(proxy, names[i])))
+			continue;
+		upower_display_set(upower, names[i], value);
+		g_variant_unref(value);
+	}
+
+	upower->proxy = proxy;
+	upower->properties_id = g_signal_connect(proxy, "g-properties-changed", G_CALLBACK(upower_display_properties_callback), upower);
 
 	kill(getpid(), SIGRTMIN + UPOWER_SIGNAL);
 }
 
-upower_t *
-upower_find(const char *device)
+static void
+upower_device_added_callback(UpClient *client, UpDevice *device, gpointer user_data)
 {
-	GPtrArray *devices;
 	gchar *native_path;
+
+	g_object_get(device, "native-path", &native_path, NULL);
+	if (native_path)
+		upower_track(device, native_path);
+	g_free(native_path);
+}
+
+static void
+upower_device_removed_callback(UpClient *client, const gchar *path, gpointer user_data)
+{
+	void *val;
+
+	if (reg_get(&upower_paths, REG_KEY(path), &val))
+		upower_detach(val);
+}
+
+static void
+upower_devices_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GPtrArray *devices;
 	guint i;
-	int check;
-	UpDevice *gdevice;
-	upower_t *upower;
 
-	if (!upower_client)
-		return NULL;
+	if ((devices = up_client_get_devices_finish(upower_client, res, NULL))) {
+		for (i = 0; i < devices->len; i++)
+			upower_device_added_callback(upower_client, g_ptr_array_index(devices, i), NULL);
+		g_ptr_array_unref(devices);
+	}
+
+	/* aggregate of all batteries, what a desktop shows in its panel */
+	g_dbus_proxy_new_for_bus(
+			G_BUS_TYPE_SYSTEM,
+			G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+			NULL,
+			UPOWER_NAME,
+			UPOWER_DISPLAY_PATH,
+			UPOWER_NAME ".Device",
+			NULL,
+			upower_display_callback,
+			NULL);
+
+	trace("upower", 1);
+}
 
-	TAILQ_FOREACH(upower, &upower_queue, entry)
-		if (!strcmp(upower->device, device))
-			return upower;
+static void
+upower_client_callback(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	upower_client = up_client_new_finish(res, NULL);
+	if (!upower_client) {
+		trace("upower", 0);
+		return;
+	}
 
-	devices = up_client_get_devices2(upower_client);
-	for (i = 0; i < devices->len; i++) {
-		gdevice = g_ptr_array_index(devices, i);
-		g_object_get(gdevice, "native-path", &native_path, NULL);
-		check = strcmp(native_path, device);
-		g_free(native_path);
+	g_signal_connect(upower_client, "device-added", G_CALLBACK(upower_device_added_callback), NULL);
+	g_signal_connect(upower_client, "device-removed", G_CALLBACK(upower_device_removed_callback), NULL);
 
-		if (!check) {
-			upower = calloc(1, sizeof(upower_t));
-			upower->device = device;
+	up_client_get_devices_async(upower_client, NULL, upower_devices_callback, NULL);
+}
 
-			TAILQ_INSERT_TAIL(&upower_queue, upower, entry);
+void
+upower_init(void)
+{
+	up_client_new_async(NULL, upower_client_callback, NULL);
+}
 
-			upower_update_from_device(upower, gdevice);
+void
+upower_free(void)
+{
+	size_t iter = 0;
+	upower_t *upower;
+	void *val;
 
-			g_signal_connect(G_OBJECT(gdevice), "notify", G_CALLBACK(upower_device_callback), upower);
+	while (reg_next(&upower_registry, &iter, &val)) {
+		upower = val;
+		upower_detach(upower);
 
-			return upower;
+		if (upower->model) {
+			g_free(upower->model);
+			upower->model = NULL;
 		}
+
+		free(upower);
 	}
 
-	g_ptr_array_unref(devices);
+	reg_free(&upower_registry);
+	reg_free(&upower_paths);
 
-	return NULL;
+	if (upower_client) {
+		g_object_unref(upower_client);
+		upower_client = NULL;
+	}
+}
+
+upower_t *
+upower_find(const char *device)
+{
+	void *val;
+
+	return reg_get(&upower_registry, REG_KEY(device), &val) ? val : NULL;
+}
+
+static int
+upower_present(const upower_t *upower)
+{
+	return upower->gdevice || upower->proxy;
+}
+
+static upower_t *
+upower_bind(struct seg *s, const char *device, int gran)
+{
+	if (!s->handle && s->gen != upower_gen) {
+		s->gen = upower_gen;
+		if ((s->handle = upower_find(device)))
+			qbind(&((upower_t *)s->handle)->perc, gran);
+	}
+
+	return s->handle;
 }
 
 const char *
-upower_line(const char *device)
+upower_line(struct seg *s, const char *device)
 {
-	char *icon;
+	const char *icon;
 	upower_t *upower;
 
-	upower = upower_find(device);
-	if (!upower)
+	upower = upower_bind(s, device, GRAN_VALUE);
+	if (!upower || !upower_present(upower))
 		return NULL;
 
-	if (upower->state == UP_DEVICE_STATE_DISCHARGING) {
-		if (upower->percentage < 5)
-			icon = "󰂎";
-		else if (upower->percentage < 15)
-			icon = "󰁺";
-		else if (upower->percentage < 25)
-			icon = "󰁻";
-		else if (upower->percentage < 35)
-			icon = "󰁼";
-		else if (upower->percentage < 45)
-			icon = "󰁽";
-		else if (upower->percentage < 55)
-			icon = "󰁾";
-		else if (upower->percentage < 65)
-			icon = "󰁿";
-		else if (upower->percentage < 75)
-			icon = "󰂀";
-		else if (upower->percentage < 85)
-			icon = "󰂁";
-		else if (upower->percentage < 95)
-			icon = "󰂂";
-		else
-			icon = "󰁹";
-	} else {
-		if (upower->percentage < 5)
-			icon = "󰢟";
-		else if (upower->percentage < 15)
-			icon = "󰢜";
-		else if (upower->percentage < 25)
-			icon = "󰂆";
-		else if (upower->percentage < 35)
-			icon = "󰂇";
-		else if (upower->percentage < 45)
-			icon = "󰂈";
-		else if (upower->percentage < 55)
-			icon = "󰢝";
-		else if (upower->percentage < 65)
-			icon = "󰂉";
-		else if (upower->percentage < 75)
-			icon = "󰢞";
-		else if (upower->percentage < 85)
-			icon = "󰂊";
-		else if (upower->percentage < 95)
-			icon = "󰂋";
-		else
-			icon = "󰂅";
-	}
+	if (upower->state == UP_DEVICE_STATE_DISCHARGING)
+		icon = upower_discharging_icons[upower->perc.level];
+	else
+		icon = upower_charging_icons[upower->perc.level];
 
-	return bprintf("%s %d%%", icon, (int)upower->percentage);
+	return vicon(s, icon, upower->perc.val);
 }
 
 const char *
-upower_perc(const char *device)
+upower_perc(struct seg *s, const char *device)
 {
-	upower_t *upower = upower_find(device);
-	return upower ? bprintf("%d", (int)upower->percentage) : NULL;
+	upower_t *upower = upower_bind(s, device, GRAN_VALUE);
+	return (upower && upower_present(upower)) ? vnum(s, VAL_PERC, upower->perc.val) : NULL;
 }
 
 const char *
-upower_state(const char *device)
+upower_state(struct seg *s, const char *device)
 {
-	upower_t *upower = upower_find(device);
-	return upower ? up_device_state_to_string(upower->state) : NULL;
+	upower_t *upower = upower_bind(s, device, GRAN_NONE);
+	return (upower && upower_present(upower)) ? up_device_state_to_string(upower->state) : NULL;
 }
+#endif
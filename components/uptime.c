@@ -15,10 +15,9 @@
 #endif
 
 const char *
-uptime(const char *unused)
+uptime(struct seg *s, const char *unused)
 {
 	char warn_buf[256];
-	uintmax_t h, m;
 	struct timespec uptime;
 
 	if (clock_gettime(UPTIME_FLAG, &uptime) < 0) {
@@ -27,8 +26,6 @@ uptime(const char *unused)
 		return NULL;
 	}
 
-	h = uptime.tv_sec / 3600;
-	m = uptime.tv_sec % 3600 / 60;
-
-	return bprintf("%juh %jum", h, m);
+	/* shown to the minute */
+	return vnum(s, VAL_SECS, uptime.tv_sec / 60 * 60);
 }
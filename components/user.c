@@ -8,13 +8,13 @@
 #include "../util.h"
 
 const char *
-gid(const char *unused)
+gid(struct seg *s, const char *unused)
 {
-	return bprintf("%d", getgid());
+	return bprintf(s, "%d", getgid());
 }
 
 const char *
-username(const char *unused)
+username(struct seg *s, const char *unused)
 {
 	struct passwd *pw;
 
@@ -23,11 +23,11 @@ username(const char *unused)
 		return NULL;
 	}
 
-	return bprintf("%s", pw->pw_name);
+	return bprintf(s, "%s", pw->pw_name);
 }
 
 const char *
-uid(const char *unused)
+uid(struct seg *s, const char *unused)
 {
-	return bprintf("%d", geteuid());
+	return bprintf(s, "%d", geteuid());
 }
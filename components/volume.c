@@ -144,7 +144,7 @@
 	}
 
 	const char *
-	vol_perc(const char *unused)
+	vol_perc(struct seg *s, const char *unused)
 	{
 		struct control *c;
 		int n, v, value;
@@ -180,14 +180,14 @@
 			}
 		}
 
-		return bprintf("%d", value);
+		return bprintf(s, "%d", value);
 	}
 #elif defined(ALSA)
 	#include <alsa/asoundlib.h>
 
 	static const char *devname = "default";
 	const char *
-	vol_perc(const char *mixname)
+	vol_perc(struct seg *s, const char *mixname)
 	{
 		snd_mixer_t *mixer = NULL;
 		snd_mixer_selem_id_t *mixid = NULL;
@@ -235,13 +235,13 @@
 		snd_mixer_detach(mixer, devname);
 		snd_mixer_close(mixer);
 
-		return volume == -1 ? NULL : bprintf("%.0f", (volume-min)*100./(max-min));
+		return volume == -1 ? NULL : bprintf(s, "%.0f", (volume-min)*100./(max-min));
 	}
 #else
 	#include <sys/soundcard.h>
 
 	const char *
-	vol_perc(const char *card)
+	vol_perc(struct seg *s, const char *card)
 	{
 		size_t i;
 		int v, afd, devmask;
@@ -269,6 +269,6 @@
 
 		close(afd);
 
-		return bprintf("%d", v & 0xff);
+		return bprintf(s, "%d", v & 0xff);
 	}
 #endif
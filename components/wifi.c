@@ -119,7 +119,7 @@
 	}
 
 	const char *
-	wifi_essid(const char *interface)
+	wifi_essid(struct seg *s, const char *interface)
 	{
 		uint16_t fam = nl80211fam();
 		ssize_t r;
@@ -175,7 +175,7 @@
 	}
 
 	const char *
-	wifi_perc(const char *interface)
+	wifi_perc(struct seg *s, const char *interface)
 	{
 		static char strength[4];
 		struct nlmsghdr hdr;
@@ -288,7 +288,7 @@
 	}
 
 	const char *
-	wifi_perc(const char *interface)
+	wifi_perc(struct seg *s, const char *interface)
 	{
 		struct ieee80211_nodereq nr;
 		int q;
@@ -299,19 +299,19 @@
 			else
 				q = RSSI_TO_PERC(nr.nr_rssi);
 
-			return bprintf("%d", q);
+			return vnum(s, VAL_PERC, q);
 		}
 
 		return NULL;
 	}
 
 	const char *
-	wifi_essid(const char *interface)
+	wifi_essid(struct seg *s, const char *interface)
 	{
 		struct ieee80211_nodereq nr;
 
 		if (load_ieee80211_nodereq(interface, &nr))
-			return bprintf("%s", nr.nr_nwid);
+			return bprintf(s, "%s", nr.nr_nwid);
 
 		return NULL;
 	}
@@ -342,7 +342,7 @@
 	}
 
 	const char *
-	wifi_perc(const char *interface)
+	wifi_perc(struct seg *s, const char *interface)
 	{
 		union {
 			struct ieee80211req_sta_req sta;
@@ -373,7 +373,7 @@
 				rssi_dbm = info.sta.info[0].isi_noise +
  					         info.sta.info[0].isi_rssi / 2;
 
-				fmt = bprintf("%d", RSSI_TO_PERC(rssi_dbm));
+				fmt = bprintf(s, "%d", RSSI_TO_PERC(rssi_dbm));
 			}
 		}
 
@@ -382,7 +382,7 @@
 	}
 
 	const char *
-	wifi_essid(const char *interface)
+	wifi_essid(struct seg *s, const char *interface)
 	{
 		char ssid[IEEE80211_NWID_LEN + 1];
 		size_t len;
@@ -404,7 +404,7 @@
 				len = sizeof(ssid);
 
 			ssid[len - 1] = '\0';
-			fmt = bprintf("%s", ssid);
+			fmt = bprintf(s, "%s", ssid);
 		}
 
 		close(sockfd);
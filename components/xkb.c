@@ -0,0 +1,158 @@
+/* See LICENSE file for copyright and license details. */
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <X11/XKBlib.h>
+#include <X11/Xlib.h>
+
+#include "../slstatus.h"
+#include "../util.h"
+
+#ifdef USE_XKB
+#include "../loop.h"
+#include "../xout.h"
+
+/* state of the core keyboard, updated from XKB events */
+char xkb_symbols[256];
+int xkb_group;
+unsigned int xkb_leds;
+int xkb_ready;
+
+static Display *xkb_dpy;
+static int xkb_owned;
+static int xkb_event_base;
+
+static int
+xkb_get_symbols(void)
+{
+	XkbDescRec *desc;
+	char *symbols;
+	int ret = 0;
+
+	if (!(desc = XkbAllocKeyboard())) {
+		warn("XkbAllocKeyboard: Failed to allocate keyboard");
+		return 0;
+	}
+	if (XkbGetNames(xkb_dpy, XkbSymbolsNameMask, desc)) {
+		warn("XkbGetNames: Failed to retrieve key symbols");
+		goto end;
+	}
+	if (!(symbols = XGetAtomName(xkb_dpy, desc->names->symbols))) {
+		warn("XGetAtomName: Failed to get atom name");
+		goto end;
+	}
+	snprintf(xkb_symbols, sizeof(xkb_symbols), "%s", symbols);
+	XFree(symbols);
+	ret = 1;
+end:
+	XkbFreeKeyboard(desc, XkbSymbolsNameMask, 1);
+
+	return ret;
+}
+
+static void
+xkb_event(XEvent *e)
+{
+	XkbEvent *ev = (XkbEvent *)e;
+	int changed = 0;
+
+	if (ev->type != xkb_event_base)
+		return;
+
+	switch (ev->any.xkb_type) {
+	case XkbStateNotify:
+		changed = ev->state.group != xkb_group;
+		xkb_group = ev->state.group;
+		break;
+	case XkbNamesNotify:
+		changed = xkb_get_symbols();
+		break;
+	case XkbIndicatorStateNotify:
+		changed = ev->indicators.state != xkb_leds;
+		xkb_leds = ev->indicators.state;
+		break;
+	}
+
+	if (changed)
+		kill(getpid(), SIGRTMIN + XKB_SIGNAL);
+}
+
+/* only with a connection of our own, the output one is read by xout */
+static void
+xkb_read(int fd, void *arg)
+{
+	XEvent ev;
+
+	while (XPending(xkb_dpy)) {
+		XNextEvent(xkb_dpy, &ev);
+		xkb_event(&ev);
+	}
+}
+
+void
+xkb_init(void)
+{
+	XkbStateRec state;
+	int opcode, error, major = XkbMajorVersion, minor = XkbMinorVersion;
+
+	/* share the output connection, -s has none */
+	if (!(xkb_dpy = dpy)) {
+		if (!(xkb_dpy = XOpenDisplay(NULL))) {
+			warn("XOpenDisplay: Failed to open display");
+			trace("xkb", 0);
+			return;
+		}
+		xkb_owned = 1;
+	}
+
+	if (!XkbQueryExtension(xkb_dpy, &opcode, &xkb_event_base, &error, &major, &minor)) {
+		warn("XkbQueryExtension: XKB not available");
+		if (xkb_owned)
+			XCloseDisplay(xkb_dpy);
+		xkb_dpy = NULL;
+		xkb_owned = 0;
+		trace("xkb", 0);
+		return;
+	}
+
+	/* only layout switches and LED toggles, not every modifier press */
+	XkbSelectEvents(xkb_dpy, XkbUseCoreKbd,
+	                XkbStateNotifyMask | XkbNamesNotifyMask | XkbIndicatorStateNotifyMask,
+	                XkbStateNotifyMask | XkbNamesNotifyMask | XkbIndicatorStateNotifyMask);
+	XkbSelectEventDetails(xkb_dpy, XkbUseCoreKbd, XkbStateNotify,
+	                      XkbAllStateComponentsMask, XkbGroupStateMask);
+	XkbSelectEventDetails(xkb_dpy, XkbUseCoreKbd, XkbNamesNotify,
+	                      XkbAllNamesMask, XkbSymbolsNameMask);
+
+	if (!XkbGetState(xkb_dpy, XkbUseCoreKbd, &state))
+		xkb_group = state.group;
+	else
+		warn("XkbGetState: Failed to retrieve keyboard state");
+	if (XkbGetIndicatorState(xkb_dpy, XkbUseCoreKbd, &xkb_leds))
+		warn("XkbGetIndicatorState: Failed to retrieve indicators");
+	xkb_get_symbols();
+
+	/* replies above may have queued events poll will not see */
+	if (xkb_owned) {
+		loop_add(ConnectionNumber(xkb_dpy), xkb_read, NULL);
+		loop_drain(ConnectionNumber(xkb_dpy));
+	} else {
+		xout_watch(xkb_event);
+	}
+	xkb_ready = 1;
+	trace("xkb", 1);
+}
+
+void
+xkb_free(void)
+{
+	if (xkb_ready && xkb_owned)
+		loop_del(ConnectionNumber(xkb_dpy));
+	xkb_ready = 0;
+
+	if (xkb_owned && XCloseDisplay(xkb_dpy) < 0)
+		warn("XCloseDisplay: Failed to close display");
+	xkb_dpy = NULL;
+	xkb_owned = 0;
+}
+#endif
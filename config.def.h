@@ -5,6 +5,30 @@
 /* interval between updates (in ms) */
 const unsigned int interval = 1000;
 
+/* rate at which NetworkManager pushes device byte counters (in ms) */
+const unsigned int nm_stats_interval = 1000;
+
+/* margin (in percent) a value must pass an icon threshold by, 0 to disable */
+const int hysteresis = 2;
+
+/* updates between full frames with -d (0: only the first), the rest carry changes */
+static const unsigned int keyframe = 60;
+
+/* shared memory object segments are published in (see shm.h), NULL for none */
+static const char *snapshot = NULL;
+
+/* unix socket segments are served on (see srv.h), NULL for none */
+static const char *sockpath = NULL;
+
+/*
+ * Prometheus metrics (see prom.h) on a port of 127.0.0.1 ("9101") or a
+ * unix socket ("/run/user/1000/slstatus.prom"), NULL for none
+ */
+static const char *metrics = NULL;
+
+/* samples of a segment kept for the hist_* functions reading it, 0 to disable */
+const unsigned int history = 60;
+
 /* text to show if no value can be retrieved */
 static const char unknown_str[] = "";
 
@@ -30,6 +54,13 @@ static const char unknown_str[] = "";
  * disk_used           used disk space in GB           mountpoint path (/)
  * entropy             available entropy               NULL
  * gid                 GID of current user             NULL
+ * hist_avg            average of the last samples     args[] index of a
+ *                     of another segment              numeric segment (0)
+ * hist_max            maximum of the last samples     args[] index (0)
+ * hist_min            minimum of the last samples     args[] index (0)
+ * hist_p95            95th percentile of the last     args[] index (0)
+ *                     samples
+ * hist_spark          sparkline of the last samples   args[] index (0)
  * hostname            hostname                        NULL
  * ipv4                IPv4 address                    interface name (eth0)
  * ipv6                IPv6 address                    interface name (eth0)
@@ -68,14 +99,34 @@ static const char unknown_str[] = "";
  */
 static const struct arg args[] = {
 	/* function				format    argument						turn	signal */
-	{ nm_line,				" %s ",		"enp0s20f0u4u4u3",	0,		NM_SIGNAL },
-	{ nm_line, 				" %s ",		"wlp2s0f0",					0, 		NM_SIGNAL },
-	{ keymap,					" 󰌌 %s ",	NULL,								1, 		-1 },
-	{ pa_line,				" %s ",		NULL, 							0, 		PA_SIGNAL },
-	{ backlight_line,	" %s ", 	"intel_backlight",	1, 		BACKLIGHT_SIGNAL },
-	{ upower_line,		" %s ", 	"BAT0",							0, 		UPOWER_SIGNAL },
-	{ ppd_line,				" %s ",		NULL,								0, 		PPD_SIGNAL },
-	{ datetime,				"  %s",	"%a %d %b %H:%M",		1, 		-1 },
+	ARG(nm_line,				" %s ",		"enp0s20f0u4u4u3",	0,		NM_SIGNAL),
+	ARG(nm_line, 				" %s ",		"wlp2s0f0",					0, 		NM_SIGNAL),
+	ARG(keymap,					" 󰌌 %s ",	NULL,								0, 		XKB_SIGNAL),
+	ARG(pa_line,				" %s ",		NULL, 							0, 		PA_SIGNAL),
+	ARG(backlight_line,	" %s ", 	"intel_backlight",	1, 		BACKLIGHT_SIGNAL),
+	ARG(upower_line,		" %s ", 	"BAT0",							0, 		UPOWER_SIGNAL),
+	ARG(ppd_line,				" %s ",		NULL,								0, 		PPD_SIGNAL),
+	ARG(datetime,				"  %s",	"%a %d %b %H:%M",		1, 		-1),
+};
+
+/*
+ * destinations of the status without -s, -j or -d
+ *
+ * type                path
+ *
+ * SINK_X              root window name                NULL
+ * SINK_STDOUT         one line per status             NULL
+ * SINK_FILE           file, replaced by rename(2)     file path
+ * SINK_FIFO           named pipe, skipped while       fifo path
+ *                     nobody reads it
+ *
+ * rate is the minimum time between writes in ms (0: none), segs picks the
+ * args[] entries shown by index with SEGS(i, j, ...) (NULL: all). A sink
+ * is only written to when its text changed.
+ */
+static const struct sink sinks[] = {
+	/* type				path		rate	segs */
+	{ SINK_X,			NULL,		0,		NULL },
 };
 
  /* maximum output string length */
@@ -12,11 +12,12 @@ X11LIB = /usr/X11R6/lib
 
 # flags
 CPPFLAGS = -I$(X11INC) -D_DEFAULT_SOURCE -DVERSION=\"${VERSION}\" -DALSA
-CFLAGS   = -std=c99 -pedantic -Wall -Wextra -Wno-unused-parameter -Os `pkg-config --cflags libnm libpulse libudev mm-glib upower-glib`
-LDFLAGS  = -L$(X11LIB) -s -lasound `pkg-config --libs libnm libpulse libudev mm-glib upower-glib`
+CFLAGS   = -std=c99 -pedantic -Wall -Wextra -Wno-unused-parameter -Os `sh backends.sh cflags config.h`
+LDFLAGS  = -L$(X11LIB) -s -lasound `sh backends.sh libs config.h`
+# glibc before 2.34: add -lrt
 # OpenBSD: add -lsndio
 # FreeBSD: add -lkvm -lsndio
-LDLIBS   = -lX11
+LDLIBS   = -lX11 -lX11-xcb -lxcb
 
 # compiler and linker
 CC = cc
@@ -0,0 +1,98 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+
+#include "loop.h"
+#include "util.h"
+
+#define LOOP_MAX 32
+
+static struct pollfd fds[LOOP_MAX];
+static struct {
+	void (*cb)(int, void *);
+	void *arg;
+	int drain;
+} handlers[LOOP_MAX];
+static size_t nfds;
+
+void
+loop_add(int fd, void (*cb)(int, void *), void *arg)
+{
+	if (nfds == LOOP_MAX)
+		die("loop_add: more than %d descriptors", LOOP_MAX);
+
+	fds[nfds].fd = fd;
+	fds[nfds].events = POLLIN;
+	handlers[nfds].cb = cb;
+	handlers[nfds].arg = arg;
+	handlers[nfds].drain = 0;
+	nfds++;
+}
+
+void
+loop_del(int fd)
+{
+	size_t i;
+
+	for (i = 0; i < nfds; i++) {
+		if (fds[i].fd != fd)
+			continue;
+		nfds--;
+		fds[i] = fds[nfds];
+		handlers[i] = handlers[nfds];
+		return;
+	}
+}
+
+/* also run cb of fd when it can be written to, while on is set */
+void
+loop_out(int fd, int on)
+{
+	size_t i;
+
+	for (i = 0; i < nfds; i++)
+		if (fds[i].fd == fd)
+			fds[i].events = on ? POLLIN | POLLOUT : POLLIN;
+}
+
+/*
+ * also run cb of fd before every poll, for connections whose library
+ * reads ahead (Xlib) and may hold input poll never hears about
+ */
+void
+loop_drain(int fd)
+{
+	size_t i;
+
+	for (i = 0; i < nfds; i++)
+		if (fds[i].fd == fd)
+			handlers[i].drain = 1;
+}
+
+/* 0 on timeout, -1 if a signal came in, else the number of ready descriptors */
+int
+loop_wait(int timeout)
+{
+	size_t i;
+	int n;
+
+	for (i = nfds; i-- > 0; )
+		if (handlers[i].drain)
+			handlers[i].cb(fds[i].fd, handlers[i].arg);
+
+	if ((n = poll(fds, nfds, timeout)) < 0) {
+		if (errno == EINTR)
+			return -1;
+		die("poll:");
+	}
+
+	/* callbacks may remove themselves, walk backwards */
+	for (i = nfds; i-- > 0; ) {
+		if (fds[i].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR))
+			handlers[i].cb(fds[i].fd, handlers[i].arg);
+		fds[i].revents = 0;
+	}
+
+	return n;
+}
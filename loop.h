@@ -0,0 +1,12 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * poll(2) loop of the main thread: descriptors registered with loop_add()
+ * have their callback run from loop_wait(), which also returns early on
+ * signals so the renderer can react to them
+ */
+void loop_add(int fd, void (*cb)(int fd, void *arg), void *arg);
+void loop_del(int fd);
+void loop_out(int fd, int on);
+void loop_drain(int fd);
+int loop_wait(int timeout);
@@ -0,0 +1,405 @@
+/* See LICENSE file for copyright and license details. */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "loop.h"
+#include "prom.h"
+#include "util.h"
+
+#define PROM_CLIENTS 4
+
+struct page {
+	char *data;
+	size_t len, size;
+	int readers;
+};
+
+struct client {
+	int fd;
+	int page;       /* -1 until the request is read */
+	char head[128];
+	size_t headlen;
+	size_t off;     /* bytes of head and page sent */
+	char in[512];
+	size_t inlen;
+};
+
+struct sample {
+	int numeric;
+	double num;
+	struct timespec spent;
+	unsigned long long calls;
+};
+
+static int lfd = -1;
+static const char *upath;
+static const char *const *names;
+static const char *const *argv;
+static struct sample *samples;
+static size_t nsegs;
+static unsigned long long updates, skipped;
+/* scrapes are served from the front page while the other one is rendered */
+static struct page pages[2];
+static int front;
+static struct client *clients[PROM_CLIENTS];
+
+static void
+drop(struct client *c)
+{
+	size_t i;
+
+	for (i = 0; i < PROM_CLIENTS; i++)
+		if (clients[i] == c)
+			clients[i] = NULL;
+	if (c->page >= 0)
+		pages[c->page].readers--;
+
+	loop_del(c->fd);
+	close(c->fd);
+	free(c);
+}
+
+static void
+serve(struct client *c)
+{
+	struct page *p = &pages[c->page];
+	const char *data;
+	size_t len;
+	ssize_t n;
+
+	for (;;) {
+		if (c->off < c->headlen) {
+			data = c->head + c->off;
+			len = c->headlen - c->off;
+		} else if (c->off < c->headlen + p->len) {
+			data = p->data + (c->off - c->headlen);
+			len = p->len - (c->off - c->headlen);
+		} else {
+			drop(c);
+			return;
+		}
+
+		if ((n = send(c->fd, data, len, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				loop_out(c->fd, 1);
+			else
+				drop(c);
+			return;
+		}
+		c->off += n;
+	}
+}
+
+static void
+readclient(int fd, void *arg)
+{
+	struct client *c = arg;
+	ssize_t n;
+
+	if (c->page >= 0) {
+		serve(c);
+		return;
+	}
+
+	if ((n = read(fd, c->in + c->inlen, sizeof(c->in) - 1 - c->inlen)) <= 0) {
+		if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			drop(c);
+		return;
+	}
+	c->inlen += n;
+	c->in[c->inlen] = '\0';
+
+	/* whatever was asked for, the metrics are sent once the header is in */
+	if (!strstr(c->in, "\r\n\r\n") && !strstr(c->in, "\n\n")) {
+		if (c->inlen == sizeof(c->in) - 1)
+			drop(c);
+		return;
+	}
+
+	c->page = front;
+	pages[front].readers++;
+	c->headlen = snprintf(c->head, sizeof(c->head),
+	                      "HTTP/1.0 200 OK\r\n"
+	                      "Content-Type: text/plain; version=0.0.4\r\n"
+	                      "Content-Length: %zu\r\n\r\n", pages[front].len);
+
+	serve(c);
+}
+
+static void
+accept_client(int fd, void *arg)
+{
+	struct client *c;
+	size_t i;
+	int cfd;
+
+	if ((cfd = accept(fd, NULL, NULL)) < 0)
+		return;
+
+	for (i = 0; i < PROM_CLIENTS && clients[i]; i++)
+		;
+	if (i == PROM_CLIENTS) {
+		close(cfd);
+		return;
+	}
+
+	fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+	fcntl(cfd, F_SETFD, FD_CLOEXEC);
+
+	if (!(c = calloc(1, sizeof(*c))))
+		die("calloc:");
+	c->fd = cfd;
+	c->page = -1;
+	clients[i] = c;
+	loop_add(cfd, readclient, c);
+}
+
+static void
+put(struct page *p, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(p->data + p->len, p->size - p->len, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			return;
+		if ((size_t)n < p->size - p->len) {
+			p->len += n;
+			return;
+		}
+		p->size = p->size * 2 + n + 1;
+		if (!(p->data = realloc(p->data, p->size)))
+			die("realloc:");
+	}
+}
+
+/* label value with \, " and newline escaped */
+static const char *
+label(const char *s)
+{
+	static char esc[2][256];
+	static int k;
+	char *d;
+
+	k = !k;
+	for (d = esc[k]; s && *s && d < esc[k] + sizeof(esc[k]) - 2; s++) {
+		if (*s == '\\' || *s == '"' || *s == '\n') {
+			*d++ = '\\';
+			*d++ = *s == '\n' ? 'n' : *s;
+		} else {
+			*d++ = *s;
+		}
+	}
+	*d = '\0';
+
+	return esc[k];
+}
+
+static void
+render(struct page *p)
+{
+	size_t i;
+
+	p->len = 0;
+	put(p, "# HELP slstatus_value Numeric value returned by a segment function.\n"
+	       "# TYPE slstatus_value gauge\n");
+	for (i = 0; i < nsegs; i++) {
+		if (!samples[i].numeric)
+			continue;
+		put(p, "slstatus_value{index=\"%zu\",function=\"%s\",", i, label(names[i]));
+		put(p, "arg=\"%s\"} %.15g\n", label(argv[i]), samples[i].num);
+	}
+
+	put(p, "# HELP slstatus_segment_seconds_total Time spent in a segment function.\n"
+	       "# TYPE slstatus_segment_seconds_total counter\n");
+	for (i = 0; i < nsegs; i++)
+		put(p, "slstatus_segment_seconds_total{index=\"%zu\",function=\"%s\"} %ld.%09ld\n",
+		    i, label(names[i]), (long)samples[i].spent.tv_sec, samples[i].spent.tv_nsec);
+
+	put(p, "# HELP slstatus_segment_calls_total Calls of a segment function.\n"
+	       "# TYPE slstatus_segment_calls_total counter\n");
+	for (i = 0; i < nsegs; i++)
+		put(p, "slstatus_segment_calls_total{index=\"%zu\",function=\"%s\"} %llu\n",
+		    i, label(names[i]), samples[i].calls);
+
+	put(p, "# HELP slstatus_updates_total Status updates rendered.\n"
+	       "# TYPE slstatus_updates_total counter\n"
+	       "slstatus_updates_total %llu\n"
+	       "# HELP slstatus_metrics_skipped_total Updates not exported because both pages were being read.\n"
+	       "# TYPE slstatus_metrics_skipped_total counter\n"
+	       "slstatus_metrics_skipped_total %llu\n", updates, skipped);
+}
+
+static int
+listen_unix(const char *path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		warn("prom: socket path too long '%s'", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		warn("socket:");
+		return -1;
+	}
+
+	/* a socket left behind by an earlier run */
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    chmod(path, 0600) < 0) {
+		warn("prom: '%s':", path);
+		close(fd);
+		return -1;
+	}
+	upath = path;
+
+	return fd;
+}
+
+static int
+listen_tcp(const char *port)
+{
+	struct sockaddr_in addr;
+	int fd, on = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(atoi(port));
+	/* loopback only, the values are nobody else's business */
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		warn("socket:");
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		warn("prom: port %s:", port);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int
+prom_init(const char *addr, const char *const *n, const char *const *a, size_t len)
+{
+	lfd = addr[0] == '/' ? listen_unix(addr) : listen_tcp(addr);
+	if (lfd < 0)
+		return -1;
+
+	if (listen(lfd, PROM_CLIENTS) < 0) {
+		warn("listen:");
+		prom_free();
+		return -1;
+	}
+	fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) | O_NONBLOCK);
+	fcntl(lfd, F_SETFD, FD_CLOEXEC);
+
+	if (!(samples = calloc(len, sizeof(*samples))))
+		die("calloc:");
+	names = n;
+	argv = a;
+	nsegs = len;
+
+	front = 0;
+	render(&pages[front]);
+	loop_add(lfd, accept_client, NULL);
+
+	return 0;
+}
+
+void
+prom_sample(size_t i, const struct value *v, const char *text, const struct timespec *spent)
+{
+	struct sample *s;
+	char *end;
+
+	if (lfd < 0)
+		return;
+
+	/* typed values as they are, text only if it is a plain number */
+	s = &samples[i];
+	if (text == v->text && v->type != VAL_NONE) {
+		s->num = v->num;
+		s->numeric = 1;
+	} else {
+		s->num = strtod(text, &end);
+		s->numeric = end != text && !*end;
+	}
+	s->spent.tv_sec += spent->tv_sec;
+	s->spent.tv_nsec += spent->tv_nsec;
+	if (s->spent.tv_nsec >= 1000000000) {
+		s->spent.tv_sec++;
+		s->spent.tv_nsec -= 1000000000;
+	}
+	s->calls++;
+}
+
+void
+prom_end(void)
+{
+	if (lfd < 0)
+		return;
+
+	updates++;
+	/* a slow scrape still holds the other page, keep serving the old one */
+	if (pages[!front].readers) {
+		skipped++;
+		return;
+	}
+
+	render(&pages[!front]);
+	front = !front;
+}
+
+void
+prom_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < PROM_CLIENTS; i++)
+		if (clients[i])
+			drop(clients[i]);
+
+	if (lfd >= 0) {
+		if (samples)
+			loop_del(lfd);
+		close(lfd);
+		lfd = -1;
+	}
+	if (upath) {
+		unlink(upath);
+		upath = NULL;
+	}
+
+	free(samples);
+	samples = NULL;
+	for (i = 0; i < 2; i++) {
+		free(pages[i].data);
+		pages[i].data = NULL;
+		pages[i].len = pages[i].size = 0;
+	}
+}
@@ -0,0 +1,17 @@
+/* See LICENSE file for copyright and license details. */
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * Prometheus exposition of the samples over HTTP, on a unix socket
+ * (addr starting with '/') or a port on the loopback address. Numeric
+ * segment values and per-segment time and call counters are rendered
+ * after each update into one of two pages; scrapes are served from the
+ * other one and never wait for the render loop.
+ */
+int prom_init(const char *addr, const char *const *names, const char *const *args, size_t n);
+struct value;
+
+void prom_sample(size_t i, const struct value *v, const char *text, const struct timespec *spent);
+void prom_end(void);
+void prom_free(void);
@@ -0,0 +1,226 @@
+/* See LICENSE file for copyright and license details. */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "registry.h"
+#include "util.h"
+
+#define REG_MIN 16
+
+static char **strings;
+static size_t nstrings, sstrings;
+static pthread_mutex_t strings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t
+hash_str(const char *s)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *s; s++)
+		h = (h ^ (unsigned char)*s) * 16777619u;
+
+	return h;
+}
+
+static size_t
+hash_key(uintptr_t key)
+{
+	uint64_t h = key;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+
+	return (size_t)h;
+}
+
+static void
+intern_grow(void)
+{
+	char **old = strings;
+	size_t i, j, size = sstrings;
+
+	sstrings = size ? size * 2 : REG_MIN;
+	if (!(strings = calloc(sstrings, sizeof(*strings))))
+		die("calloc:");
+
+	for (i = 0; i < size; i++) {
+		if (!old[i])
+			continue;
+		for (j = hash_str(old[i]) & (sstrings - 1); strings[j];
+		     j = (j + 1) & (sstrings - 1))
+			;
+		strings[j] = old[i];
+	}
+
+	free(old);
+}
+
+/* backends intern from their own threads as well */
+const char *
+intern(const char *s)
+{
+	size_t i;
+	const char *str;
+
+	if (!s)
+		return NULL;
+
+	pthread_mutex_lock(&strings_lock);
+
+	if (2 * (nstrings + 1) > sstrings)
+		intern_grow();
+
+	for (i = hash_str(s) & (sstrings - 1); strings[i];
+	     i = (i + 1) & (sstrings - 1))
+		if (!strcmp(strings[i], s))
+			goto end;
+
+	if (!(strings[i] = strdup(s)))
+		die("strdup:");
+	nstrings++;
+end:
+	/* another thread may grow, and free, the table once we unlock */
+	str = strings[i];
+	pthread_mutex_unlock(&strings_lock);
+
+	return str;
+}
+
+static struct slot *
+reg_lookup(const struct registry *reg, uintptr_t key)
+{
+	size_t i, mask;
+
+	if (!reg->size)
+		return NULL;
+
+	mask = reg->size - 1;
+	for (i = hash_key(key) & mask; reg->slots[i].used; i = (i + 1) & mask)
+		if (reg->slots[i].key == key)
+			return &reg->slots[i];
+
+	return NULL;
+}
+
+static void
+reg_rehash(struct registry *reg, size_t size, int negative)
+{
+	struct slot *old = reg->slots;
+	size_t i, j, oldsize = reg->size;
+
+	if (!(reg->slots = calloc(size, sizeof(*reg->slots))))
+		die("calloc:");
+	reg->size = size;
+	reg->len = 0;
+
+	for (i = 0; i < oldsize; i++) {
+		if (!old[i].used || (!negative && !old[i].val))
+			continue;
+		for (j = hash_key(old[i].key) & (size - 1); reg->slots[j].used;
+		     j = (j + 1) & (size - 1))
+			;
+		reg->slots[j] = old[i];
+		reg->len++;
+	}
+
+	free(old);
+}
+
+int
+reg_get(const struct registry *reg, uintptr_t key, void **val)
+{
+	struct slot *slot;
+
+	if (!(slot = reg_lookup(reg, key)))
+		return 0;
+
+	*val = slot->val;
+
+	return 1;
+}
+
+void
+reg_put(struct registry *reg, uintptr_t key, void *val)
+{
+	struct slot *slot;
+	size_t i, mask;
+
+	if ((slot = reg_lookup(reg, key))) {
+		slot->val = val;
+		return;
+	}
+
+	if (2 * (reg->len + 1) > reg->size)
+		reg_rehash(reg, reg->size ? reg->size * 2 : REG_MIN, 1);
+
+	mask = reg->size - 1;
+	for (i = hash_key(key) & mask; reg->slots[i].used; i = (i + 1) & mask)
+		;
+
+	reg->slots[i].key = key;
+	reg->slots[i].val = val;
+	reg->slots[i].used = 1;
+	reg->len++;
+}
+
+void
+reg_del(struct registry *reg, uintptr_t key)
+{
+	struct slot *slot;
+	size_t i, j, k, mask;
+
+	if (!(slot = reg_lookup(reg, key)))
+		return;
+
+	/* backward-shift deletion keeps probe sequences intact */
+	mask = reg->size - 1;
+	i = j = slot - reg->slots;
+	reg->slots[i].used = 0;
+	reg->len--;
+
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!reg->slots[j].used)
+			break;
+
+		k = hash_key(reg->slots[j].key) & mask;
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		reg->slots[i] = reg->slots[j];
+		reg->slots[j].used = 0;
+		i = j;
+	}
+}
+
+void
+reg_purge(struct registry *reg)
+{
+	if (reg->size)
+		reg_rehash(reg, reg->size, 0);
+}
+
+int
+reg_next(const struct registry *reg, size_t *iter, void **val)
+{
+	while (*iter < reg->size) {
+		if (reg->slots[*iter].used && reg->slots[*iter].val) {
+			*val = reg->slots[(*iter)++].val;
+			return 1;
+		}
+		(*iter)++;
+	}
+
+	return 0;
+}
+
+void
+reg_free(struct registry *reg)
+{
+	free(reg->slots);
+	reg->slots = NULL;
+	reg->size = reg->len = 0;
+}
@@ -0,0 +1,30 @@
+/* See LICENSE file for copyright and license details. */
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Open-addressing table mapping keys to backend objects. Keys are either
+ * numeric indices or strings passed through intern(), which are compared
+ * by address. A NULL value caches a negative lookup.
+ */
+struct slot {
+	uintptr_t key;
+	void *val;
+	int used;
+};
+
+struct registry {
+	struct slot *slots;
+	size_t size;
+	size_t len;
+};
+
+#define REG_KEY(str) ((uintptr_t)intern(str))
+
+const char *intern(const char *);
+int reg_get(const struct registry *, uintptr_t, void **);
+void reg_put(struct registry *, uintptr_t, void *);
+void reg_del(struct registry *, uintptr_t);
+void reg_purge(struct registry *);
+int reg_next(const struct registry *, size_t *, void **);
+void reg_free(struct registry *);
@@ -0,0 +1,191 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring.h"
+#include "util.h"
+
+struct ring **rings;
+static size_t nrings;
+
+static void *
+ecalloc(size_t n, size_t size)
+{
+	void *p;
+
+	if (!(p = calloc(n, size)))
+		die("calloc:");
+
+	return p;
+}
+
+/* first position in sorted with a value above v */
+static size_t
+upper(const struct ring *r, intmax_t v)
+{
+	size_t lo = 0, hi = r->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (r->sorted[mid] <= v)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+void
+ring_init(size_t n)
+{
+	rings = ecalloc(n, sizeof(*rings));
+	nrings = n;
+}
+
+/* args[] index in arg, -1 if it holds none */
+long
+ring_index(const char *arg)
+{
+	char *end;
+	unsigned long i;
+
+	if (!arg || !*arg)
+		return -1;
+	errno = 0;
+	i = strtoul(arg, &end, 10);
+	if (errno || *end || i >= nrings)
+		return -1;
+
+	return i;
+}
+
+struct ring *
+ring_get(size_t i)
+{
+	extern const unsigned int history;
+	struct ring *r;
+
+	if (!history || i >= nrings)
+		return NULL;
+	if (rings[i])
+		return rings[i];
+
+	r = ecalloc(1, sizeof(*r));
+	r->cap = history;
+	r->val = ecalloc(r->cap, sizeof(*r->val));
+	r->sorted = ecalloc(r->cap, sizeof(*r->sorted));
+	r->mins = ecalloc(r->cap, sizeof(*r->mins));
+	r->maxs = ecalloc(r->cap, sizeof(*r->maxs));
+
+	return rings[i] = r;
+}
+
+void
+ring_push(struct ring *r, int type, intmax_t v)
+{
+	intmax_t old;
+	size_t j;
+
+	/* samples of another kind do not compare with the ones before */
+	if (type != r->type) {
+		r->type = type;
+		r->len = r->minl = r->maxl = 0;
+		r->sum = 0;
+	}
+
+	if (r->len == r->cap) {
+		old = r->val[r->n % r->cap];
+		r->sum -= old;
+		j = upper(r, old) - 1;
+		memmove(r->sorted + j, r->sorted + j + 1,
+		        (r->len - j - 1) * sizeof(*r->sorted));
+		r->len--;
+
+		/* the oldest sample can only be at the fronts */
+		if (r->minl && r->mins[r->minh] + r->cap <= r->n) {
+			r->minh = (r->minh + 1) % r->cap;
+			r->minl--;
+		}
+		if (r->maxl && r->maxs[r->maxh] + r->cap <= r->n) {
+			r->maxh = (r->maxh + 1) % r->cap;
+			r->maxl--;
+		}
+	}
+
+	r->val[r->n % r->cap] = v;
+	r->sum += v;
+	j = upper(r, v);
+	memmove(r->sorted + j + 1, r->sorted + j,
+	        (r->len - j) * sizeof(*r->sorted));
+	r->sorted[j] = v;
+	r->len++;
+
+	while (r->minl &&
+	       r->val[r->mins[(r->minh + r->minl - 1) % r->cap] % r->cap] >= v)
+		r->minl--;
+	r->mins[(r->minh + r->minl++) % r->cap] = r->n;
+
+	while (r->maxl &&
+	       r->val[r->maxs[(r->maxh + r->maxl - 1) % r->cap] % r->cap] <= v)
+		r->maxl--;
+	r->maxs[(r->maxh + r->maxl++) % r->cap] = r->n;
+
+	r->n++;
+}
+
+/* k-th sample of the window, oldest first */
+intmax_t
+ring_at(const struct ring *r, size_t k)
+{
+	return r->val[(r->n - r->len + k) % r->cap];
+}
+
+intmax_t
+ring_min(const struct ring *r)
+{
+	return r->val[r->mins[r->minh] % r->cap];
+}
+
+intmax_t
+ring_max(const struct ring *r)
+{
+	return r->val[r->maxs[r->maxh] % r->cap];
+}
+
+intmax_t
+ring_avg(const struct ring *r)
+{
+	return r->sum / (intmax_t)r->len;
+}
+
+/* nearest-rank p-th percentile */
+intmax_t
+ring_pct(const struct ring *r, int p)
+{
+	size_t rank;
+
+	rank = (r->len * p + 99) / 100;
+
+	return r->sorted[rank ? rank - 1 : 0];
+}
+
+void
+ring_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < nrings; i++) {
+		if (!rings[i])
+			continue;
+		free(rings[i]->val);
+		free(rings[i]->sorted);
+		free(rings[i]->mins);
+		free(rings[i]->maxs);
+		free(rings[i]);
+	}
+	free(rings);
+	rings = NULL;
+	nrings = 0;
+}
@@ -0,0 +1,36 @@
+/* See LICENSE file for copyright and license details. */
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * last samples of a segment's typed value, kept as separate arrays. The
+ * window minimum and maximum are the fronts of monotonic deques, the
+ * average comes from a running sum and percentiles from a sorted copy,
+ * so none of them rescans the window.
+ */
+struct ring {
+	size_t cap;
+	size_t len;
+	unsigned long n;       /* samples pushed so far */
+	int type;              /* VAL_* of the last sample */
+	intmax_t sum;
+	intmax_t *val;         /* sample k at k % cap */
+	intmax_t *sorted;      /* the len samples in ascending order */
+	unsigned long *mins;   /* sample numbers, values ascending */
+	unsigned long *maxs;   /* sample numbers, values descending */
+	size_t minh, minl, maxh, maxl;
+};
+
+/* rings by args[] index, NULL unless some hist_* entry reads it */
+extern struct ring **rings;
+
+void ring_init(size_t n);
+long ring_index(const char *arg);
+struct ring *ring_get(size_t i);
+void ring_push(struct ring *r, int type, intmax_t v);
+intmax_t ring_at(const struct ring *r, size_t k);
+intmax_t ring_min(const struct ring *r);
+intmax_t ring_max(const struct ring *r);
+intmax_t ring_avg(const struct ring *r);
+intmax_t ring_pct(const struct ring *r, int p);
+void ring_free(void);
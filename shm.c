@@ -0,0 +1,122 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+#endif
+
+#include "shm.h"
+#include "util.h"
+
+static struct shm_header *hdr;
+static size_t size;
+static const char *path;
+
+static char *
+record(size_t i)
+{
+	return (char *)(hdr + 1) + i * hdr->segsize;
+}
+
+int
+shm_init(const char *name, size_t nsegs, size_t textlen)
+{
+	void *p;
+	int fd;
+
+	size = sizeof(*hdr) + nsegs * (SHM_NAMELEN + 2 * textlen);
+
+	/*
+	 * readers may still map an object left by an earlier run, shrinking
+	 * it would SIGBUS them; they keep the old one, we start a new one
+	 */
+	if (shm_unlink(name) < 0 && errno != ENOENT)
+		warn("shm_unlink '%s':", name);
+	if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) {
+		warn("shm_open '%s':", name);
+		return -1;
+	}
+	if (ftruncate(fd, size) < 0) {
+		warn("ftruncate:");
+		goto err;
+	}
+	if ((p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		warn("mmap:");
+		goto err;
+	}
+	close(fd);
+
+	/* zero-filled by ftruncate(), seq starts out even */
+	hdr = p;
+	hdr->version = SHM_VERSION;
+	hdr->nsegs = nsegs;
+	hdr->segsize = SHM_NAMELEN + 2 * textlen;
+	hdr->textlen = textlen;
+	__atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+	path = name;
+
+	return 0;
+err:
+	close(fd);
+	shm_unlink(name);
+	return -1;
+}
+
+void
+shm_name(size_t i, const char *name)
+{
+	if (hdr)
+		snprintf(record(i), SHM_NAMELEN, "%s", name);
+}
+
+void
+shm_begin(void)
+{
+	if (!hdr)
+		return;
+
+	__atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void
+shm_set(size_t i, const char *value, const char *text)
+{
+	char *r;
+
+	if (!hdr)
+		return;
+
+	r = record(i) + SHM_NAMELEN;
+	snprintf(r, hdr->textlen, "%s", value);
+	snprintf(r + hdr->textlen, hdr->textlen, "%s", text);
+}
+
+void
+shm_end(void)
+{
+	if (!hdr)
+		return;
+
+	__atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELEASE);
+#if defined(__linux__)
+	syscall(SYS_futex, &hdr->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+void
+shm_free(void)
+{
+	if (!hdr)
+		return;
+
+	munmap(hdr, size);
+	hdr = NULL;
+	shm_unlink(path);
+}
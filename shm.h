@@ -0,0 +1,33 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdint.h>
+
+/*
+ * Snapshot of all segments in a POSIX shared memory object, guarded by a
+ * sequence lock. The mapping starts with struct shm_header, followed by
+ * nsegs records of segsize bytes each: the function name (SHM_NAMELEN
+ * bytes), the raw value returned by it and the rendered text (textlen
+ * bytes each), all NUL-terminated.
+ *
+ * Readers load seq, copy what they need and load seq again; the copy is
+ * consistent if both loads are equal and even. On Linux a reader may
+ * sleep on seq with FUTEX_WAIT, every update wakes all waiters.
+ */
+#define SHM_MAGIC   0x736c7374 /* "slst" */
+#define SHM_VERSION 1
+#define SHM_NAMELEN 32
+
+struct shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t nsegs;
+	uint32_t segsize;
+	uint32_t textlen;
+};
+
+int shm_init(const char *name, size_t nsegs, size_t textlen);
+void shm_name(size_t i, const char *name);
+void shm_begin(void);
+void shm_set(size_t i, const char *value, const char *text);
+void shm_end(void);
+void shm_free(void);
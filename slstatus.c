@@ -1,64 +1,263 @@
 /* See LICENSE file for copyright and license details. */
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <time.h>
-#include <X11/Xlib.h>
+#include <unistd.h>
 
 #include "arg.h"
+#include "bus.h"
+#include "loop.h"
 #include "slstatus.h"
+#include "prom.h"
+#include "ring.h"
+#include "shm.h"
+#include "srv.h"
+#include "uevent.h"
 #include "util.h"
+#include "xout.h"
 
 struct arg {
-	const char *(*func)(const char *);
+	const char *(*func)(struct seg *, const char *);
 	const char *fmt;
 	const char *args;
 	unsigned int turn;
 	int signal;
+	const char *name;
 };
 
-char buf[1024];
+/* args[] entry named after its function, for the JSON, srv and prom output */
+#define ARG(func, fmt, args, turn, signal) \
+	{ func, fmt, args, turn, signal, #func }
+
+enum { SINK_X, SINK_STDOUT, SINK_FILE, SINK_FIFO };
+
+struct sink {
+	int type;
+	const char *path;
+	unsigned int rate;
+	const int *segs;
+};
+
+/* args[] indexes a sink shows, see sinks[] in config.h */
+#define SEGS(...) ((const int []){ __VA_ARGS__, -1 })
+
 static unsigned int iter = 0;
 static int sflag = 0;
 static int Sflag = 0;
+static int tflag = 0;
+static int jflag = 0;
+static int dflag = 0;
+static struct timespec started;
+static int painted = 0;
 static volatile sig_atomic_t done, upsigno;
-static Display *dpy;
 
 #include "config.h"
 #define MAXLEN CMDLEN * LEN(args)
+/* text and instance with every byte escaped as \u00XX, plus the name and keys */
+#define BLOCKLEN (2 * CMDLEN * 6 + 256)
 
+/* backends.h lists only the backends the functions in args[] need */
+#define INIT(b) b##_init();
+#define FREE(b) b##_free();
+
+#ifdef USE_BUS
+/* on the bus thread, once the system bus is there */
 static void
-setup(void)
+busready(void)
 {
-	backlight_init();
-	mm_init();
-	nm_init();
-	pa_init();
-	ppd_init();
-	upower_init();
+	BUS_BACKENDS(INIT)
 }
+#endif
 
 static void
-tick(void)
+setup(void)
 {
-	nm_tick();
-	pa_tick();
+#ifdef USE_UDEV
+	uevent_init();
+#endif
+	LOCAL_BACKENDS(INIT)
+
+#ifdef USE_BUS
+	bus_init(busready);
+	bus_start();
+#endif
 }
 
+static struct seg segs[LEN(args)];
+/* output buffers of the functions, one CMDLEN slice per segment */
+static char arena[MAXLEN];
+
 static void
 teardown(void)
 {
-	backlight_free();
-	mm_free();
-	nm_free();
-	pa_free();
-	ppd_free();
-	upower_free();
+	size_t i;
+
+	for (i = 0; i < LEN(args); i++)
+		if (segs[i].unbind)
+			segs[i].unbind(segs[i].handle);
+
+#ifdef USE_BUS
+	bus_stop();
+#endif
+	LOCAL_BACKENDS(FREE)
+	BUS_BACKENDS(FREE)
+#ifdef USE_BUS
+	bus_free();
+#endif
+#ifdef USE_UDEV
+	uevent_free();
+#endif
 }
 
 static char statuses[LEN(args)][CMDLEN] = {0};
+/* function names in args[], NULL for entries not written with ARG() */
+static const char *names[LEN(args)];
+/* i3bar blocks, serialised again only when their segment changed */
+static char blocks[LEN(args)][BLOCKLEN];
+/* segments changed since the last delta written */
+static char dirty[LEN(args)];
+/* values returned by the functions, and which changed since published */
+static char values[LEN(args)][CMDLEN];
+static char fresh[LEN(args)];
+/* segments whose last result was a typed value */
+static char typed[LEN(args)];
+/* arguments in args[], for labelling metrics */
+static const char *argstrs[LEN(args)];
+/* args[].fmt split around its %s once, see compile() */
+static struct {
+	char text[CMDLEN]; /* literal parts, %% collapsed */
+	size_t pre, post;  /* their lengths before and after the %s */
+	int slot;          /* has a %s, -1 if left to printf */
+} tmpls[LEN(args)];
+
+static struct {
+	char last[MAXLEN];
+	struct timespec at;
+	int written;
+	int fd;
+	char shows[LEN(args)];
+} sinkstate[LEN(sinks)];
+
+static size_t
+jsonescape(char *dst, size_t size, const char *src)
+{
+	static const char hex[] = "0123456789abcdef";
+	unsigned char c;
+	size_t n = 0;
+
+	for (; (c = *src) && n + 7 < size; src++) {
+		if (c == '"' || c == '\\') {
+			dst[n++] = '\\';
+			dst[n++] = c;
+		} else if (c < 0x20) {
+			memcpy(dst + n, "\\u00", 4);
+			dst[n + 4] = hex[c >> 4];
+			dst[n + 5] = hex[c & 0xf];
+			n += 6;
+		} else {
+			dst[n++] = c;
+		}
+	}
+	dst[n] = '\0';
+
+	return n;
+}
+
+static void
+jsonblock(size_t i)
+{
+	char text[CMDLEN * 6 + 1], instance[CMDLEN * 6 + 1];
+	int n;
+
+	/* both clamped to their buffers, a long command line included */
+	jsonescape(text, sizeof(text), statuses[i]);
+	if (args[i].args)
+		jsonescape(instance, sizeof(instance), args[i].args);
+
+	n = snprintf(blocks[i], sizeof(blocks[i]),
+	             "{\"name\":\"%s\",%s%s%s\"full_text\":\"%s\","
+	             "\"separator\":false,\"separator_block_width\":0}",
+	             names[i] ? names[i] : "",
+	             args[i].args ? "\"instance\":\"" : "",
+	             args[i].args ? instance : "",
+	             args[i].args ? "\"," : "",
+	             text);
+	if (n < 0 || (size_t)n >= sizeof(blocks[i])) {
+		warn("jsonblock: block of '%s' does not fit", names[i] ? names[i] : "");
+		blocks[i][0] = '\0';
+	}
+}
+
+/* index<TAB>value per changed segment, an empty line ends the update */
+static void
+printdelta(void)
+{
+	static unsigned int n;
+	const char *p;
+	size_t i;
+	int full, records = 0;
+
+	full = keyframe ? !(n % keyframe) : !n;
+	n++;
+
+	for (i = 0; i < LEN(args); i++) {
+		if (!full && !dirty[i])
+			continue;
+		dirty[i] = 0;
+		records++;
+
+		printf("%zu\t", i);
+		for (p = statuses[i]; *p; p++) {
+			if (*p == '\\')
+				fputs("\\\\", stdout);
+			else if (*p == '\t')
+				fputs("\\t", stdout);
+			else if (*p == '\n')
+				fputs("\\n", stdout);
+			else
+				putchar(*p);
+		}
+		putchar('\n');
+	}
+
+	/* nothing changed, nothing to write */
+	if (!records)
+		return;
+
+	putchar('\n');
+	fflush(stdout);
+	if (ferror(stdout))
+		die("puts:");
+}
+
+static void
+printjson(void)
+{
+	static int first = 1;
+	size_t i;
+	int sep = 0;
+
+	fputs(first ? "[" : ",[", stdout);
+	first = 0;
+	for (i = 0; i < LEN(args); i++) {
+		if (!blocks[i][0])
+			continue;
+		if (sep)
+			putchar(',');
+		fputs(blocks[i], stdout);
+		sep = 1;
+	}
+	puts("]");
+	fflush(stdout);
+	if (ferror(stdout))
+		die("puts:");
+}
 
 static void
 difftimespec(struct timespec *res, struct timespec *a, struct timespec *b)
@@ -71,46 +270,299 @@ difftimespec(struct timespec *res, struct timespec *a, struct timespec *b)
 static void
 usage(void)
 {
-	die("usage: %s [-v] [-s] [-S] [-1]", argv0);
+	die("usage: %s [-v] [-s] [-S] [-t] [-j] [-d] [-1]", argv0);
+}
+
+void
+trace(const char *backend, int ok)
+{
+	struct timespec now, diff;
+
+	if (!tflag || clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+		return;
+
+	difftimespec(&diff, &now, &started);
+	fprintf(stderr, "%s: %s %s after %ld.%03ld ms\n", argv0, backend,
+	        ok ? "ready" : "unavailable",
+	        (long)(diff.tv_sec * 1000 + diff.tv_nsec / 1000000),
+	        (long)(diff.tv_nsec / 1000 % 1000));
+}
+
+static void
+publish(void)
+{
+	size_t i;
+
+	for (i = 0; i < LEN(args) && !fresh[i]; i++)
+		;
+	if (i == LEN(args))
+		return;
+
+	shm_begin();
+	for (; i < LEN(args); i++) {
+		if (fresh[i])
+			shm_set(i, values[i], statuses[i]);
+		fresh[i] = 0;
+	}
+	shm_end();
+}
+
+/* 0 if the text could not be written and should be retried */
+static int
+writesink(size_t i, const char *text)
+{
+	char tmp[PATH_MAX];
+	struct iovec iov[2];
+	size_t len = strlen(text);
+	ssize_t n;
+	int fd;
+
+	switch (sinks[i].type) {
+	case SINK_X:
+		return xout_set(text);
+	case SINK_STDOUT:
+		puts(text);
+		fflush(stdout);
+		if (ferror(stdout))
+			die("puts:");
+		return 1;
+	case SINK_FILE:
+		/* readers see either the old or the new file, never a partial one */
+		if (esnprintf(tmp, sizeof(tmp), "%s.tmp", sinks[i].path) < 0)
+			return 0;
+		if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+			warn("open '%s':", tmp);
+			return 0;
+		}
+		if (write(fd, text, len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+			warn("write '%s':", tmp);
+			close(fd);
+			return 0;
+		}
+		close(fd);
+		if (rename(tmp, sinks[i].path) < 0) {
+			warn("rename '%s':", tmp);
+			return 0;
+		}
+		return 1;
+	case SINK_FIFO:
+		/* ENXIO: no reader yet, try again next time */
+		if (sinkstate[i].fd < 0 &&
+		    (sinkstate[i].fd = open(sinks[i].path, O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0)
+			return 0;
+		/* one record per write, atomic up to PIPE_BUF */
+		iov[0].iov_base = (char *)text;
+		iov[0].iov_len = len;
+		iov[1].iov_base = "\n";
+		iov[1].iov_len = 1;
+		if ((n = writev(sinkstate[i].fd, iov, 2)) == (ssize_t)len + 1)
+			return 1;
+		/*
+		 * a full pipe took nothing, anything else left the reader gone or
+		 * with half a line: it reopens and starts on a fresh record
+		 */
+		if (n >= 0 || errno != EAGAIN) {
+			close(sinkstate[i].fd);
+			sinkstate[i].fd = -1;
+		}
+		return 0;
+	}
+
+	return 0;
+}
+
+static void
+writesinks(void)
+{
+	char text[MAXLEN];
+	struct timespec now, diff;
+	size_t i, j;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+		die("clock_gettime:");
+
+	for (i = 0; i < LEN(sinks); i++) {
+		text[0] = '\0';
+		for (j = 0; j < LEN(args); j++)
+			if (sinkstate[i].shows[j])
+				strcat(text, statuses[j]);
+
+		if (sinkstate[i].written && !strcmp(text, sinkstate[i].last))
+			continue;
+		difftimespec(&diff, &now, &sinkstate[i].at);
+		if (sinkstate[i].written &&
+		    diff.tv_sec * 1000 + diff.tv_nsec / 1000000 < sinks[i].rate)
+			continue;
+
+		if (!writesink(i, text))
+			continue;
+		memcpy(sinkstate[i].last, text, sizeof(text));
+		sinkstate[i].at = now;
+		sinkstate[i].written = 1;
+	}
+}
+
+static int
+ishist(const struct arg *a)
+{
+	return a->func == hist_spark || a->func == hist_min ||
+	       a->func == hist_max || a->func == hist_avg ||
+	       a->func == hist_p95;
+}
+
+static void
+compile(void)
+{
+	const char *f;
+	size_t i, n;
+
+	for (i = 0; i < LEN(args); i++) {
+		for (f = args[i].fmt, n = 0; *f && n < CMDLEN - 1; f++) {
+			if (*f != '%') {
+				tmpls[i].text[n++] = *f;
+			} else if (f[1] == '%') {
+				tmpls[i].text[n++] = *++f;
+			} else if (f[1] == 's' && !tmpls[i].slot) {
+				tmpls[i].pre = n;
+				tmpls[i].slot = 1;
+				f++;
+			} else {
+				/* widths, precisions and the like */
+				break;
+			}
+		}
+		if (*f) {
+			tmpls[i].slot = -1;
+			continue;
+		}
+		tmpls[i].text[n] = '\0';
+		if (!tmpls[i].slot)
+			tmpls[i].pre = n;
+		tmpls[i].post = n - tmpls[i].pre;
+	}
+}
+
+/* args[i].fmt applied to res, -1 if it does not fit */
+static int
+render(size_t i, char *seg, const char *res)
+{
+	size_t len;
+
+	if (tmpls[i].slot < 0)
+		return esnprintf(seg, CMDLEN, args[i].fmt, res);
+
+	len = tmpls[i].slot ? strlen(res) : 0;
+	if (tmpls[i].pre + len + tmpls[i].post >= CMDLEN) {
+		warn("render: Output truncated");
+		return -1;
+	}
+	memcpy(seg, tmpls[i].text, tmpls[i].pre);
+	memcpy(seg + tmpls[i].pre, res, len);
+	memcpy(seg + tmpls[i].pre + len, tmpls[i].text + tmpls[i].pre,
+	       tmpls[i].post);
+	seg[tmpls[i].pre + len + tmpls[i].post] = '\0';
+
+	return tmpls[i].pre + len + tmpls[i].post;
 }
 
+/* one sample per interval for the hist_* segments, whether or not i ran */
 static void
-printstatus(unsigned int iter)
+sample(size_t i)
+{
+	if (rings[i] && typed[i])
+		ring_push(rings[i], segs[i].val.type, segs[i].val.num);
+}
+
+/* tick: a run of the interval loop, not a refresh asked for by a signal */
+static void
+printstatus(unsigned int iter, int tick)
 {
 	size_t i;
-	char status[MAXLEN];
+	char status[MAXLEN], seg[CMDLEN];
 	const char *res;
+	struct timespec t0, t1, spent;
 
+	bus_lock();
 	for (i = 0; i < LEN(args); i++) {
 		if (iter && !((!iter && !upsigno) || upsigno == SIGUSR1 ||
 				(!upsigno && args[i].turn > 0 && !(iter % args[i].turn)) ||
-				(args[i].signal >= 0 && upsigno - SIGRTMIN == args[i].signal)))
+				(args[i].signal >= 0 && upsigno - SIGRTMIN == args[i].signal))) {
+			/* not due, its last value stands for this interval */
+			if (tick)
+				sample(i);
 			continue;
+		}
 
-		if (!(res = args[i].func(args[i].args)))
+		if (metrics)
+			clock_gettime(CLOCK_MONOTONIC, &t0);
+		if (!(res = args[i].func(&segs[i], args[i].args)))
 			res = unknown_str;
+		/* after NULL or literal text the next value is new, whatever it is */
+		if (res != segs[i].val.text)
+			segs[i].val.type = VAL_NONE;
+		if (metrics) {
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			difftimespec(&spent, &t1, &t0);
+			prom_sample(i, &segs[i].val, res, &spent);
+		}
+		typed[i] = res == segs[i].val.text;
+		if (tick)
+			sample(i);
+
+		/* a typed value that did not change needs no formatting */
+		if (res == segs[i].val.text && !segs[i].val.changed)
+			continue;
 
-		if (esnprintf(statuses[i], sizeof(statuses[i]), args[i].fmt, res) < 0)
+		if (snapshot && strncmp(res, values[i], sizeof(values[i]) - 1)) {
+			strncpy(values[i], res, sizeof(values[i]) - 1);
+			fresh[i] = 1;
+		}
+
+		if (render(i, seg, res) < 0)
 			break;
+		if (!strcmp(seg, statuses[i]))
+			continue;
+
+		memcpy(statuses[i], seg, sizeof(seg));
+		dirty[i] = fresh[i] = 1;
+		if (sockpath)
+			srv_set(i, statuses[i]);
+		if (jflag)
+			jsonblock(i);
 	}
+	bus_unlock();
 
 	upsigno = 0;
 
+	if (snapshot)
+		publish();
+	if (sockpath)
+		srv_end();
+	if (metrics)
+		prom_end();
+
 	status[0] = '\0';
 	for (i = 0; i < LEN(args); i++)
 		strcat(status, statuses[i]);
 	status[strlen(status)] = '\0';
 
 	if (Sflag || iter) {
-		if (sflag) {
+		if (jflag) {
+			printjson();
+		} else if (dflag) {
+			printdelta();
+		} else if (sflag) {
 			puts(status);
 			fflush(stdout);
 			if (ferror(stdout))
 				die("puts:");
 		} else {
-			if (XStoreName(dpy, DefaultRootWindow(dpy), status) < 0)
-				die("XStoreName: Allocation failed");
-			XFlush(dpy);
+			writesinks();
+		}
+
+		if (!painted) {
+			painted = 1;
+			trace("status", 1);
 		}
 	}
 }
@@ -132,6 +584,7 @@ main(int argc, char *argv[])
 	struct sigaction act;
 	struct timespec start, current, diff, intspec, wait;
 	int i, ret = 0;
+	long j;
 
 	ARGBEGIN {
 	case 'v':
@@ -146,6 +599,15 @@ main(int argc, char *argv[])
 	case 'S':
 		Sflag = 1;
 		break;
+	case 't':
+		tflag = 1;
+		break;
+	case 'j':
+		jflag = sflag = 1;
+		break;
+	case 'd':
+		dflag = sflag = 1;
+		break;
 	default:
 		usage();
 	} ARGEND
@@ -153,54 +615,105 @@ main(int argc, char *argv[])
 	if (argc)
 		usage();
 
+	if (clock_gettime(CLOCK_MONOTONIC, &started) < 0)
+		die("clock_gettime:");
+
 	memset(&act, 0, sizeof(act));
 	act.sa_handler = sighandler;
 	sigaction(SIGINT,  &act, NULL);
 	sigaction(SIGTERM, &act, NULL);
 	sigaction(SIGUSR1, &act, NULL);
+	/* a fifo sink losing its reader must not end us */
+	act.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &act, NULL);
+	act.sa_handler = sighandler;
 	for (i = SIGRTMIN; i <= SIGRTMAX; i++)
 		sigaction(i, &act, NULL);
 
-	if (!sflag && !(dpy = XOpenDisplay(NULL)))
-		die("XOpenDisplay: Failed to open display");
+	for (i = 0; i < (int)LEN(sinks); i++) {
+		sinkstate[i].fd = -1;
+		if (!sinks[i].segs)
+			memset(sinkstate[i].shows, 1, sizeof(sinkstate[i].shows));
+		for (j = 0; sinks[i].segs && sinks[i].segs[j] >= 0; j++) {
+			if (sinks[i].segs[j] >= (int)LEN(args))
+				die("sink %d: no args[] entry %d", i, sinks[i].segs[j]);
+			sinkstate[i].shows[sinks[i].segs[j]] = 1;
+		}
+		if (!sflag && sinks[i].type == SINK_X && !dpy)
+			xout_init();
+	}
+
+	for (i = 0; i < (int)LEN(args); i++)
+		names[i] = args[i].name;
+
+	if (snapshot && !shm_init(snapshot, LEN(args), CMDLEN))
+		for (i = 0; i < (int)LEN(args); i++)
+			shm_name(i, names[i] ? names[i] : "");
+	if (sockpath)
+		srv_init(sockpath, names, LEN(args));
+	if (metrics) {
+		for (i = 0; i < (int)LEN(args); i++)
+			argstrs[i] = args[i].args;
+		prom_init(metrics, names, argstrs, LEN(args));
+	}
+
+	/* i3bar protocol header, the body is an endless array of arrays */
+	if (jflag) {
+		puts("{\"version\":1}\n[");
+		fflush(stdout);
+	}
+
+	for (i = 0; i < (int)LEN(args); i++) {
+		segs[i].buf = arena + i * CMDLEN;
+		segs[i].size = CMDLEN;
+	}
 
+	compile();
+	/* rings exist from the first sample on, not from the first reader */
+	ring_init(LEN(args));
+	for (i = 0; i < (int)LEN(args); i++)
+		if (ishist(&args[i]) && (j = ring_index(args[i].args)) >= 0)
+			ring_get(j);
 	setup();
 
 	do {
-		tick();
-
 		if (clock_gettime(CLOCK_MONOTONIC, &start) < 0)
 			die("clock_gettime:");
 
-		printstatus(iter++);
+		printstatus(iter++, 1);
 
 		if (!done) {
-			if (clock_gettime(CLOCK_MONOTONIC, &current) < 0)
-				die("clock_gettime:");
-			difftimespec(&diff, &current, &start);
-
 			intspec.tv_sec = interval / 1000;
 			intspec.tv_nsec = (interval % 1000) * 1E6;
-			difftimespec(&wait, &intspec, &diff);
 
-			while(wait.tv_sec >= 0 &&
-			      (ret = nanosleep(&wait, &wait)) < 0 &&
-			      errno == EINTR && !done) {
-				printstatus(0);
-				errno = upsigno = 0;
-			}
-			if (ret < 0 && errno != EINTR)
-				die("nanosleep:");
+			/* wait out the interval, serving uevents and signals */
+			do {
+				if (clock_gettime(CLOCK_MONOTONIC, &current) < 0)
+					die("clock_gettime:");
+				difftimespec(&diff, &current, &start);
+				difftimespec(&wait, &intspec, &diff);
+				if (wait.tv_sec < 0 || done)
+					break;
+
+				ret = loop_wait(wait.tv_sec * 1000 + wait.tv_nsec / 1E6);
+				if (upsigno && !done)
+					printstatus(0, 0);
+			} while (ret);
 		}
 	} while (!done);
 
 	teardown();
-
-	if (!sflag) {
-		XStoreName(dpy, DefaultRootWindow(dpy), NULL);
-		if (XCloseDisplay(dpy) < 0)
-			die("XCloseDisplay: Failed to close display");
-	}
+	xout_free();
+	for (i = 0; i < (int)LEN(sinks); i++)
+		if (sinkstate[i].fd >= 0)
+			close(sinkstate[i].fd);
+	if (snapshot)
+		shm_free();
+	if (sockpath)
+		srv_free();
+	if (metrics)
+		prom_free();
+	ring_free();
 
 	return 0;
 }
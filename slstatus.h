@@ -1,142 +1,174 @@
 /* See LICENSE file for copyright and license details. */
+#include "backends.h"
+
+struct seg;
+
+/* X connection of the output, NULL with -s */
+extern struct _XDisplay *dpy;
+
+/* backends report when they are usable, printed with -t */
+void trace(const char *backend, int ok);
 
 /* backlight */
 #define BACKLIGHT_SIGNAL 1
 void backlight_init(void);
-void backlight_tick(void);
 void backlight_free(void);
-const char *backlight_line(const char *);
-const char *backlight_icon(const char *);
-const char *backlight_perc(const char *);
+const char *backlight_line(struct seg *, const char *);
+const char *backlight_icon(struct seg *, const char *);
+const char *backlight_perc(struct seg *, const char *);
 
 /* battery */
-const char *battery_perc(const char *);
-const char *battery_remaining(const char *);
-const char *battery_state(const char *);
+const char *battery_perc(struct seg *, const char *);
+const char *battery_remaining(struct seg *, const char *);
+const char *battery_state(struct seg *, const char *);
 
 /* cat */
-const char *cat(const char *path);
+const char *cat(struct seg *, const char *path);
 
 /* cpu */
-const char *cpu_freq(const char *unused);
-const char *cpu_perc(const char *unused);
+const char *cpu_freq(struct seg *, const char *unused);
+const char *cpu_perc(struct seg *, const char *unused);
 
 /* datetime */
-const char *datetime(const char *fmt);
+const char *datetime(struct seg *, const char *fmt);
 
 /* disk */
-const char *disk_free(const char *path);
-const char *disk_perc(const char *path);
-const char *disk_total(const char *path);
-const char *disk_used(const char *path);
+const char *disk_free(struct seg *, const char *path);
+const char *disk_perc(struct seg *, const char *path);
+const char *disk_total(struct seg *, const char *path);
+const char *disk_used(struct seg *, const char *path);
 
 /* entropy */
-const char *entropy(const char *unused);
+const char *entropy(struct seg *, const char *unused);
+
+/* hist */
+const char *hist_spark(struct seg *, const char *index);
+const char *hist_min(struct seg *, const char *index);
+const char *hist_max(struct seg *, const char *index);
+const char *hist_avg(struct seg *, const char *index);
+const char *hist_p95(struct seg *, const char *index);
 
 /* hostname */
-const char *hostname(const char *unused);
+const char *hostname(struct seg *, const char *unused);
 
 /* ip */
-const char *ipv4(const char *interface);
-const char *ipv6(const char *interface);
-const char *up(const char *interface);
+const char *ipv4(struct seg *, const char *interface);
+const char *ipv6(struct seg *, const char *interface);
+const char *up(struct seg *, const char *interface);
 
 /* kernel_release */
-const char *kernel_release(const char *unused);
+const char *kernel_release(struct seg *, const char *unused);
 
 /* keyboard_indicators */
-const char *keyboard_indicators(const char *fmt);
+#define XKB_SIGNAL 7
+extern char xkb_symbols[256];
+extern int xkb_group;
+extern unsigned int xkb_leds;
+extern int xkb_ready;
+void xkb_init(void);
+void xkb_free(void);
+const char *keyboard_indicators(struct seg *, const char *fmt);
 
 /* keymap */
-const char *keymap(const char *unused);
+const char *keymap(struct seg *, const char *unused);
 
 /* load_avg */
-const char *load_avg(const char *unused);
+const char *load_avg(struct seg *, const char *unused);
 
 /* mm */
 #define MM_SIGNAL 2
 void mm_init(void);
-void mm_tick(void);
 void mm_free(void);
-const char *mm_line(const char *iface);
-const char *mm_perc(const char *iface);
+const char *mm_line(struct seg *, const char *iface);
+const char *mm_perc(struct seg *, const char *iface);
+const char *mm_tech(struct seg *, const char *iface);
+const char *mm_operator(struct seg *, const char *iface);
 
 /* netspeeds */
-const char *netspeed_rx(const char *interface);
-const char *netspeed_tx(const char *interface);
+const char *netspeed_rx(struct seg *, const char *interface);
+const char *netspeed_tx(struct seg *, const char *interface);
 
 /* nm */
 #define NM_SIGNAL 3
 void nm_init(void);
 void nm_free(void);
-void nm_tick(void);
-const char *nm_line(const char *interface);
-const char *nm_ip4(const char *interface);
-const char *nm_ip6(const char *interface);
-const char *nm_mac(const char *interface);
-const char *nm_vpn(const char *name);
+const char *nm_line(struct seg *, const char *interface);
+const char *nm_ip4(struct seg *, const char *interface);
+const char *nm_ip6(struct seg *, const char *interface);
+const char *nm_mac(struct seg *, const char *interface);
+const char *nm_rx(struct seg *, const char *interface);
+const char *nm_tx(struct seg *, const char *interface);
+const char *nm_vpn(struct seg *, const char *name);
 
 /* num_files */
-const char *num_files(const char *path);
+const char *num_files(struct seg *, const char *path);
 
 /* ram */
-const char *ram_free(const char *unused);
-const char *ram_perc(const char *unused);
-const char *ram_total(const char *unused);
-const char *ram_used(const char *unused);
+const char *ram_free(struct seg *, const char *unused);
+const char *ram_perc(struct seg *, const char *unused);
+const char *ram_total(struct seg *, const char *unused);
+const char *ram_used(struct seg *, const char *unused);
 
 /* run_command */
-const char *run_command(const char *cmd);
+const char *run_command(struct seg *, const char *cmd);
 
  /* pa */
 #define PA_SIGNAL 4
 void pa_init(void);
-void pa_tick(void);
 void pa_free(void);
-const char *pa_line(const char *sink);
-const char *pa_description(const char *sink);
-const char *pa_mute(const char *sink);
-const char *pa_name(const char *sink);
-const char *pa_perc(const char *sink);
+const char *pa_line(struct seg *, const char *sink);
+const char *pa_description(struct seg *, const char *sink);
+const char *pa_mute(struct seg *, const char *sink);
+const char *pa_name(struct seg *, const char *sink);
+const char *pa_perc(struct seg *, const char *sink);
+const char *pa_playing(struct seg *, const char *sink);
+const char *pa_playing_apps(struct seg *, const char *sink);
+const char *pa_recording(struct seg *, const char *source);
+const char *pa_recording_apps(struct seg *, const char *source);
+const char *pa_source_line(struct seg *, const char *source);
+const char *pa_source_description(struct seg *, const char *source);
+const char *pa_source_mute(struct seg *, const char *source);
+const char *pa_source_name(struct seg *, const char *source);
+const char *pa_source_perc(struct seg *, const char *source);
 
 /* ppd */
 #define PPD_SIGNAL 5
 void ppd_init(void);
-void ppd_tick(void);
 void ppd_free(void);
-const char *ppd_line(const char *unused);
-const char *ppd_active(const char *unused);
+const char *ppd_line(struct seg *, const char *unused);
+const char *ppd_active(struct seg *, const char *unused);
+const char *ppd_holds(struct seg *, const char *unused);
+const char *ppd_degraded(struct seg *, const char *unused);
 
 /* swap */
-const char *swap_free(const char *unused);
-const char *swap_perc(const char *unused);
-const char *swap_total(const char *unused);
-const char *swap_used(const char *unused);
+const char *swap_free(struct seg *, const char *unused);
+const char *swap_perc(struct seg *, const char *unused);
+const char *swap_total(struct seg *, const char *unused);
+const char *swap_used(struct seg *, const char *unused);
 
 /* temperature */
-const char *temp(const char *);
+const char *temp(struct seg *, const char *);
 
 /* upower */
 #define UPOWER_SIGNAL 6
 void upower_init(void);
-void upower_tick(void);
 void upower_free(void);
-const char *upower_line(const char *device);
-const char *upower_perc(const char *device);
-const char *upower_perc(const char *device);
-const char *upower_state(const char *device);
+const char *upower_line(struct seg *, const char *device);
+const char *upower_perc(struct seg *, const char *device);
+const char *upower_perc(struct seg *, const char *device);
+const char *upower_state(struct seg *, const char *device);
 
 /* uptime */
-const char *uptime(const char *unused);
+const char *uptime(struct seg *, const char *unused);
 
 /* user */
-const char *gid(const char *unused);
-const char *uid(const char *unused);
-const char *username(const char *unused);
+const char *gid(struct seg *, const char *unused);
+const char *uid(struct seg *, const char *unused);
+const char *username(struct seg *, const char *unused);
 
 /* volume */
-const char *vol_perc(const char *card);
+const char *vol_perc(struct seg *, const char *card);
 
 /* wifi */
-const char *wifi_essid(const char *interface);
-const char *wifi_perc(const char *interface);
+const char *wifi_essid(struct seg *, const char *interface);
+const char *wifi_perc(struct seg *, const char *interface);
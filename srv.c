@@ -0,0 +1,329 @@
+/* See LICENSE file for copyright and license details. */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "loop.h"
+#include "srv.h"
+#include "util.h"
+
+#define SRV_CLIENTS 16
+#define SRV_LINE    256
+/* unread output a client may have before it is dropped */
+#define SRV_QUEUE   16384
+
+struct client {
+	int fd;
+	char *subs;
+	char in[SRV_LINE];
+	size_t inlen;
+	char out[SRV_QUEUE];
+	size_t outlen;
+};
+
+static int lfd = -1;
+static const char *spath;
+static const char *const *names;
+static const char **texts;
+static char *changed;
+static size_t nsegs;
+static struct client *clients[SRV_CLIENTS];
+
+static void
+drop(struct client *c)
+{
+	size_t i;
+
+	for (i = 0; i < SRV_CLIENTS; i++)
+		if (clients[i] == c)
+			clients[i] = NULL;
+
+	loop_del(c->fd);
+	close(c->fd);
+	free(c->subs);
+	free(c);
+}
+
+/* 0 if the queue overflowed and the client was dropped */
+static int
+queue(struct client *c, const char *s, size_t len)
+{
+	if (c->outlen + len > sizeof(c->out)) {
+		warn("srv: client %d too slow, dropped", c->fd);
+		drop(c);
+		return 0;
+	}
+
+	memcpy(c->out + c->outlen, s, len);
+	c->outlen += len;
+
+	return 1;
+}
+
+static int
+queueseg(struct client *c, size_t i)
+{
+	char line[SRV_LINE * 2 + 64], *p;
+	const char *t;
+	int n;
+
+	if ((n = snprintf(line, sizeof(line), "%zu\t%s\t", i, names[i] ? names[i] : "")) < 0)
+		return 1;
+
+	p = line + n;
+	for (t = texts[i]; *t && p < line + sizeof(line) - 3; t++) {
+		if (*t == '\\' || *t == '\t' || *t == '\n') {
+			*p++ = '\\';
+			*p++ = *t == '\t' ? 't' : *t == '\n' ? 'n' : '\\';
+		} else {
+			*p++ = *t;
+		}
+	}
+	*p++ = '\n';
+
+	return queue(c, line, p - line);
+}
+
+/* 0 if the client went away */
+static int
+flush(struct client *c)
+{
+	ssize_t n;
+
+	while (c->outlen) {
+		if ((n = send(c->fd, c->out, c->outlen, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			drop(c);
+			return 0;
+		}
+		memmove(c->out, c->out + n, c->outlen - n);
+		c->outlen -= n;
+	}
+	loop_out(c->fd, c->outlen > 0);
+
+	return 1;
+}
+
+static int
+subscribe(struct client *c, char *args)
+{
+	char *tok, *end;
+	size_t i, idx;
+
+	for (tok = strtok(args, " \t"); tok; tok = strtok(NULL, " \t")) {
+		idx = strtoul(tok, &end, 10);
+		for (i = 0; i < nsegs; i++) {
+			if (!strcmp(tok, "*") || (*end == '\0' && end != tok && idx == i) ||
+			    (names[i] && !strcmp(tok, names[i])))
+				c->subs[i] = 1;
+		}
+	}
+
+	for (i = 0; i < nsegs; i++)
+		if (c->subs[i] && !queueseg(c, i))
+			return 0;
+
+	return queue(c, "\n", 1);
+}
+
+static int
+command(struct client *c, char *line)
+{
+	size_t i;
+
+	if (!strcmp(line, "get")) {
+		for (i = 0; i < nsegs; i++)
+			if (!queueseg(c, i))
+				return 0;
+		return queue(c, "\n", 1);
+	} else if (!strncmp(line, "sub ", 4)) {
+		return subscribe(c, line + 4);
+	} else if (!strcmp(line, "unsub")) {
+		memset(c->subs, 0, nsegs);
+		return queue(c, "\n", 1);
+	}
+
+	return queue(c, "error\n\n", 7);
+}
+
+static void
+readclient(int fd, void *arg)
+{
+	struct client *c = arg;
+	char *nl;
+	ssize_t n;
+
+	if (!flush(c))
+		return;
+
+	if ((n = read(fd, c->in + c->inlen, sizeof(c->in) - c->inlen)) < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			drop(c);
+		return;
+	}
+	if (n == 0) {
+		drop(c);
+		return;
+	}
+	c->inlen += n;
+
+	while ((nl = memchr(c->in, '\n', c->inlen))) {
+		*nl = '\0';
+		if (nl > c->in && nl[-1] == '\r')
+			nl[-1] = '\0';
+		if (!command(c, c->in))
+			return;
+		c->inlen -= nl + 1 - c->in;
+		memmove(c->in, nl + 1, c->inlen);
+	}
+	if (c->inlen == sizeof(c->in)) {
+		warn("srv: client %d sent an overlong line, dropped", fd);
+		drop(c);
+		return;
+	}
+
+	flush(c);
+}
+
+static void
+accept_client(int fd, void *arg)
+{
+	struct client *c;
+	size_t i;
+	int cfd;
+
+	if ((cfd = accept(fd, NULL, NULL)) < 0)
+		return;
+
+	for (i = 0; i < SRV_CLIENTS && clients[i]; i++)
+		;
+	if (i == SRV_CLIENTS) {
+		close(cfd);
+		return;
+	}
+
+	fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+	fcntl(cfd, F_SETFD, FD_CLOEXEC);
+
+	if (!(c = calloc(1, sizeof(*c))) || !(c->subs = calloc(nsegs, 1)))
+		die("calloc:");
+	c->fd = cfd;
+	clients[i] = c;
+	loop_add(cfd, readclient, c);
+}
+
+int
+srv_init(const char *path, const char *const *n, size_t len)
+{
+	struct sockaddr_un addr;
+	size_t i;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		warn("srv: socket path too long '%s'", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if ((lfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		warn("socket:");
+		return -1;
+	}
+	fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) | O_NONBLOCK);
+	fcntl(lfd, F_SETFD, FD_CLOEXEC);
+
+	/* a socket left behind by an earlier run */
+	unlink(path);
+	if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    chmod(path, 0600) < 0 || listen(lfd, SRV_CLIENTS) < 0) {
+		warn("srv: '%s':", path);
+		close(lfd);
+		lfd = -1;
+		return -1;
+	}
+
+	if (!(texts = malloc(len * sizeof(*texts))) || !(changed = calloc(len, 1)))
+		die("malloc:");
+	for (i = 0; i < len; i++)
+		texts[i] = "";
+	names = n;
+	nsegs = len;
+	spath = path;
+
+	loop_add(lfd, accept_client, NULL);
+
+	return 0;
+}
+
+void
+srv_set(size_t i, const char *text)
+{
+	if (lfd < 0)
+		return;
+
+	texts[i] = text;
+	changed[i] = 1;
+}
+
+void
+srv_end(void)
+{
+	struct client *c;
+	size_t i, j;
+	int any;
+
+	if (lfd < 0)
+		return;
+
+	for (i = 0; i < SRV_CLIENTS; i++) {
+		if (!(c = clients[i]))
+			continue;
+
+		any = 0;
+		for (j = 0; j < nsegs; j++) {
+			if (!changed[j] || !c->subs[j])
+				continue;
+			if (!queueseg(c, j))
+				break;
+			any = 1;
+		}
+		if (j < nsegs)
+			continue;
+
+		if (any && queue(c, "\n", 1))
+			flush(c);
+	}
+
+	memset(changed, 0, nsegs);
+}
+
+void
+srv_free(void)
+{
+	size_t i;
+
+	if (lfd < 0)
+		return;
+
+	for (i = 0; i < SRV_CLIENTS; i++)
+		if (clients[i])
+			drop(clients[i]);
+
+	loop_del(lfd);
+	close(lfd);
+	lfd = -1;
+	unlink(spath);
+
+	free(texts);
+	free(changed);
+}
@@ -0,0 +1,21 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * Segment values served on a unix socket. Clients send one command per
+ * line:
+ *
+ *   get              all segments, once
+ *   sub NAME...      push the segments named, by function name, index or
+ *                    *, now and whenever they change
+ *   unsub            stop all pushes
+ *
+ * Every reply and push is a batch of "index<TAB>name<TAB>text" lines,
+ * with \, tab and newline escaped, ended by an empty line. A client
+ * whose queue overflows because it does not read is disconnected.
+ */
+#include <stddef.h>
+
+int srv_init(const char *path, const char *const *names, size_t n);
+void srv_set(size_t i, const char *text);
+void srv_end(void);
+void srv_free(void);
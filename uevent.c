@@ -0,0 +1,103 @@
+/* See LICENSE file for copyright and license details. */
+#include <stddef.h>
+#include <string.h>
+
+#include "slstatus.h"
+#include "uevent.h"
+#include "util.h"
+
+#ifdef USE_UDEV
+#include <libudev.h>
+
+#include "loop.h"
+
+#define UEVENT_MAX 8
+
+struct udev *uevent_udev;
+
+static struct udev_monitor *monitor;
+static struct {
+	const char *subsystem;
+	void (*cb)(struct udev_device *, void *);
+	void *arg;
+} handlers[UEVENT_MAX];
+static size_t nhandlers;
+
+static void
+uevent_read(int fd, void *arg)
+{
+	struct udev_device *device;
+	const char *subsystem;
+	size_t i;
+
+	/* the monitor socket is non-blocking, drain it */
+	while ((device = udev_monitor_receive_device(monitor))) {
+		subsystem = udev_device_get_subsystem(device);
+		for (i = 0; subsystem && i < nhandlers; i++)
+			if (!strcmp(handlers[i].subsystem, subsystem))
+				handlers[i].cb(device, handlers[i].arg);
+		udev_device_unref(device);
+	}
+}
+
+void
+uevent_init(void)
+{
+	if (!(uevent_udev = udev_new())) {
+		warn("udev_new: failed");
+		return;
+	}
+
+	if (!(monitor = udev_monitor_new_from_netlink(uevent_udev, "udev")))
+		warn("udev_monitor_new_from_netlink: failed");
+}
+
+void
+uevent_add(const char *subsystem, void (*cb)(struct udev_device *, void *), void *arg)
+{
+	size_t i;
+	int known = 0;
+
+	if (!monitor)
+		return;
+	if (nhandlers == UEVENT_MAX)
+		die("uevent_add: more than %d handlers", UEVENT_MAX);
+
+	for (i = 0; i < nhandlers; i++)
+		known |= !strcmp(handlers[i].subsystem, subsystem);
+
+	handlers[nhandlers].subsystem = subsystem;
+	handlers[nhandlers].cb = cb;
+	handlers[nhandlers].arg = arg;
+	nhandlers++;
+
+	if (known)
+		return;
+
+	udev_monitor_filter_add_match_subsystem_devtype(monitor, subsystem, NULL);
+	if (nhandlers == 1) {
+		/* a monitor without filters would receive everything */
+		udev_monitor_enable_receiving(monitor);
+		loop_add(udev_monitor_get_fd(monitor), uevent_read, NULL);
+	} else {
+		udev_monitor_filter_update(monitor);
+	}
+}
+
+void
+uevent_free(void)
+{
+	if (monitor) {
+		if (nhandlers)
+			loop_del(udev_monitor_get_fd(monitor));
+		udev_monitor_unref(monitor);
+		monitor = NULL;
+	}
+	nhandlers = 0;
+
+	if (uevent_udev) {
+		udev_unref(uevent_udev);
+		uevent_udev = NULL;
+	}
+}
+#endif
@@ -0,0 +1,15 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * Single udev monitor shared by the components, read from the main loop.
+ * Each handler gets the uevents of one subsystem, so far only backlight
+ * registers; the monitor only receives the subsystems asked for.
+ */
+struct udev;
+struct udev_device;
+
+extern struct udev *uevent_udev;
+
+void uevent_init(void);
+void uevent_add(const char *subsystem, void (*cb)(struct udev_device *, void *), void *arg);
+void uevent_free(void);
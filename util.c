@@ -1,10 +1,12 @@
 /* See LICENSE file for copyright and license details. */
 #include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "util.h"
 
@@ -77,48 +79,88 @@ esnprintf(char *str, size_t size, const char *fmt, ...)
 }
 
 const char *
-bprintf(const char *fmt, ...)
+bprintf(struct seg *s, const char *fmt, ...)
 {
 	va_list ap;
 	int ret;
 
 	va_start(ap, fmt);
-	ret = evsnprintf(buf, sizeof(buf), fmt, ap);
+	ret = evsnprintf(s->buf, s->size, fmt, ap);
 	va_end(ap);
 
-	return (ret < 0) ? NULL : buf;
+	return (ret < 0) ? NULL : s->buf;
+}
+
+/* decimal digits of num at dst, unterminated, returns their number */
+static size_t
+fmt_uint(char *dst, uintmax_t num)
+{
+	char tmp[24];
+	size_t n = 0, i;
+
+	do
+		tmp[n++] = '0' + num % 10;
+	while (num /= 10);
+
+	for (i = 0; i < n; i++)
+		dst[i] = tmp[n - 1 - i];
+
+	return n;
+}
+
+static size_t
+fmt_int(char *dst, intmax_t num)
+{
+	if (num < 0) {
+		dst[0] = '-';
+		return 1 + fmt_uint(dst + 1, -(uintmax_t)num);
+	}
+
+	return fmt_uint(dst, num);
+}
+
+/* num scaled to one decimal and a prefix, "%.1f %s" without floats */
+static size_t
+fmt_scaled(char *dst, uintmax_t num, int base)
+{
+	static const char *prefix_1000[] = { "", "k", "M", "G", "T", "P", "E" };
+	static const char *prefix_1024[] = { "", "Ki", "Mi", "Gi", "Ti", "Pi",
+	                                     "Ei" };
+	const char **prefix = (base == 1000) ? prefix_1000 : prefix_1024;
+	uintmax_t div = 1, whole, tenth;
+	size_t i, n;
+
+	/* uintmax_t ends in the exa range, no need for zetta and yotta */
+	for (i = 0; i < LEN(prefix_1000) - 1 && num / div >= (uintmax_t)base; i++)
+		div *= base;
+
+	whole = num / div;
+	tenth = ((num % div) * 10 + div / 2) / div;
+	if (tenth == 10) {
+		whole++;
+		tenth = 0;
+	}
+
+	n = fmt_uint(dst, whole);
+	dst[n++] = '.';
+	dst[n++] = '0' + tenth;
+	dst[n++] = ' ';
+	memcpy(dst + n, prefix[i], strlen(prefix[i]));
+
+	return n + strlen(prefix[i]);
 }
 
 const char *
-fmt_human(uintmax_t num, int base)
-{
-	double scaled;
-	size_t i, prefixlen;
-	const char **prefix;
-	const char *prefix_1000[] = { "", "k", "M", "G", "T", "P", "E", "Z",
-	                              "Y" };
-	const char *prefix_1024[] = { "", "Ki", "Mi", "Gi", "Ti", "Pi", "Ei",
-	                              "Zi", "Yi" };
-
-	switch (base) {
-	case 1000:
-		prefix = prefix_1000;
-		prefixlen = LEN(prefix_1000);
-		break;
-	case 1024:
-		prefix = prefix_1024;
-		prefixlen = LEN(prefix_1024);
-		break;
-	default:
+fmt_human(struct seg *s, uintmax_t num, int base)
+{
+	if (base != 1000 && base != 1024) {
 		warn("fmt_human: Invalid base");
 		return NULL;
 	}
 
-	scaled = num;
-	for (i = 0; i < prefixlen && scaled >= base; i++)
-		scaled /= base;
+	s->buf[fmt_scaled(s->buf, num, base)] = '\0';
 
-	return bprintf("%.1f %s", scaled, prefix[i]);
+	return s->buf;
 }
 
 int
@@ -139,3 +181,211 @@ pscanf(const char *path, const char *fmt, ...)
 
 	return (n == EOF) ? -1 : n;
 }
+
+struct pfile *
+pfopen(const char *fmt, const char *arg)
+{
+	struct pfile *f;
+	int len;
+
+	if ((len = snprintf(NULL, 0, fmt, arg)) < 0) {
+		warn("snprintf:");
+		return NULL;
+	}
+	if (!(f = malloc(sizeof(*f) + len + 1)))
+		die("malloc:");
+	snprintf(f->path, len + 1, fmt, arg);
+
+	f->fd = open(f->path, O_RDONLY | O_CLOEXEC);
+
+	return f;
+}
+
+/* sysfs and procfs regenerate their contents on every read at offset 0 */
+int
+pfscanf(struct pfile *f, const char *fmt, ...)
+{
+	va_list ap;
+	char data[4096];
+	ssize_t len;
+	int n;
+
+	if (!f)
+		return -1;
+
+	if (f->fd < 0 && (f->fd = open(f->path, O_RDONLY | O_CLOEXEC)) < 0) {
+		warn("open '%s':", f->path);
+		return -1;
+	}
+
+	if ((len = pread(f->fd, data, sizeof(data) - 1, 0)) < 0) {
+		warn("pread '%s':", f->path);
+		close(f->fd);
+		f->fd = -1;
+		return -1;
+	}
+	data[len] = '\0';
+
+	va_start(ap, fmt);
+	n = vsscanf(data, fmt, ap);
+	va_end(ap);
+
+	return (n == EOF) ? -1 : n;
+}
+
+void
+pfclose(void *p)
+{
+	struct pfile *f = p;
+
+	if (!f)
+		return;
+
+	if (f->fd >= 0)
+		close(f->fd);
+	free(f);
+}
+
+struct pfile *
+segfile(struct seg *s, const char *fmt, const char *arg)
+{
+	if (!s->handle) {
+		s->handle = pfopen(fmt, arg);
+		s->unbind = pfclose;
+	}
+
+	return s->handle;
+}
+
+/* bucket of val among the ascending thresholds, sticking to prev if close */
+static int
+bucket(const int *thresholds, size_t n, int val, int prev)
+{
+	extern const int hysteresis;
+	int b;
+
+	for (b = 0; (size_t)b < n && val >= thresholds[b]; b++)
+		;
+
+	if (prev < 0 || b == prev)
+		return b;
+	if (b > prev && val < thresholds[b - 1] + hysteresis)
+		return b - 1;
+	if (b < prev && val >= thresholds[b] - hysteresis)
+		return b + 1;
+
+	return b;
+}
+
+/* bucket of val among the ascending thresholds, for indexing icon tables */
+int
+qlevel(const int *thresholds, size_t n, int val)
+{
+	return bucket(thresholds, n, val, -1);
+}
+
+void
+qinit(struct quant *q, const int *thresholds, size_t n, int val)
+{
+	q->thresholds = thresholds;
+	q->n = n;
+	q->val = val;
+	q->level = bucket(thresholds, n, val, -1);
+}
+
+void
+qbind(struct quant *q, int gran)
+{
+	if (gran > q->gran)
+		q->gran = gran;
+}
+
+int
+qset(struct quant *q, int val)
+{
+	int level;
+
+	if (val == q->val)
+		return 0;
+
+	q->val = val;
+	level = bucket(q->thresholds, q->n, val, q->level);
+	if (level != q->level) {
+		q->level = level;
+		return q->gran >= GRAN_ICON;
+	}
+
+	return q->gran == GRAN_VALUE;
+}
+
+static void
+vformat(struct value *v)
+{
+	char *t = v->text;
+	size_t n;
+
+	if (v->icon) {
+		n = strlen(v->icon);
+		memcpy(t, v->icon, n);
+		t += n;
+		*t++ = ' ';
+	}
+
+	switch (v->type) {
+	case VAL_INT:
+	case VAL_PERC:
+		t += fmt_int(t, v->num);
+		break;
+	case VAL_BYTES:
+		t += fmt_scaled(t, v->num, 1024);
+		break;
+	case VAL_SI:
+		t += fmt_scaled(t, v->num, 1000);
+		break;
+	case VAL_SECS:
+		t += fmt_int(t, v->num / 3600);
+		*t++ = 'h';
+		*t++ = ' ';
+		t += fmt_int(t, v->num % 3600 / 60);
+		*t++ = 'm';
+		break;
+	}
+	if (v->icon && v->type == VAL_PERC)
+		*t++ = '%';
+
+	*t = '\0';
+}
+
+/* store num as the value of s, its text is only formatted again on change */
+const char *
+vnum(struct seg *s, int type, intmax_t num)
+{
+	struct value *v = &s->val;
+
+	v->changed = v->type != type || v->num != num || v->icon;
+	if (v->changed) {
+		v->type = type;
+		v->num = num;
+		v->icon = NULL;
+		vformat(v);
+	}
+
+	return v->text;
+}
+
+/* like vnum(), shown as "icon num%" */
+const char *
+vicon(struct seg *s, const char *icon, int perc)
+{
+	struct value *v = &s->val;
+
+	v->changed = v->type != VAL_PERC || v->num != perc || v->icon != icon;
+	if (v->changed) {
+		v->type = VAL_PERC;
+		v->num = perc;
+		v->icon = icon;
+		vformat(v);
+	}
+
+	return v->text;
+}
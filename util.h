@@ -1,16 +1,83 @@
 /* See LICENSE file for copyright and license details. */
 #include <stdint.h>
 
-extern char buf[1024];
-
 #define LEN(x) (sizeof(x) / sizeof((x)[0]))
 
 extern char *argv0;
 
+/* kinds of numbers a component can hand over instead of text, see vnum() */
+enum {
+	VAL_NONE,  /* the component returned text */
+	VAL_INT,
+	VAL_PERC,
+	VAL_BYTES, /* shown with IEC prefixes */
+	VAL_SI,    /* shown with SI prefixes, e.g. Hz */
+	VAL_SECS,  /* duration, shown in hours and minutes */
+};
+
+/* typed value of a segment and its text, formatted only when it changed */
+struct value {
+	int type;
+	intmax_t num;
+	const char *icon;
+	int changed;
+	char text[48];
+};
+
+/*
+ * per-segment state handed to every component; handle is prepared on the
+ * first call and kept until exit, gen lets backends retry a failed bind
+ * only after their set of devices changed
+ */
+struct seg {
+	void *handle;
+	void (*unbind)(void *);
+	unsigned int gen;
+	struct value val;
+	/* output of the function, valid until its next call */
+	char *buf;
+	size_t size;
+};
+
+/* file kept open between reads, see pfopen() */
+struct pfile {
+	int fd;
+	char path[];
+};
+
+/* how much of a backend value the segments bound to it render */
+enum {
+	GRAN_NONE,  /* value is not shown */
+	GRAN_ICON,  /* only its bucket, e.g. an icon, is shown */
+	GRAN_VALUE, /* the value itself is shown */
+};
+
+/*
+ * backend value quantised into buckets by ascending thresholds; qset()
+ * reports only changes some bound segment would render differently
+ */
+struct quant {
+	const int *thresholds;
+	size_t n;
+	int val;
+	int level;
+	int gran;
+};
+
 void warn(const char *, ...);
 void die(const char *, ...);
 
 int esnprintf(char *str, size_t size, const char *fmt, ...);
-const char *bprintf(const char *fmt, ...);
-const char *fmt_human(uintmax_t num, int base);
+const char *bprintf(struct seg *s, const char *fmt, ...);
+const char *fmt_human(struct seg *s, uintmax_t num, int base);
 int pscanf(const char *path, const char *fmt, ...);
+struct pfile *pfopen(const char *fmt, const char *arg);
+int pfscanf(struct pfile *f, const char *fmt, ...);
+void pfclose(void *f);
+struct pfile *segfile(struct seg *s, const char *fmt, const char *arg);
+int qlevel(const int *thresholds, size_t n, int val);
+void qinit(struct quant *q, const int *thresholds, size_t n, int val);
+void qbind(struct quant *q, int gran);
+int qset(struct quant *q, int val);
+const char *vnum(struct seg *s, int type, intmax_t num);
+const char *vicon(struct seg *s, const char *icon, int perc);
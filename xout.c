@@ -0,0 +1,164 @@
+/* See LICENSE file for copyright and license details. */
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+
+#include "loop.h"
+#include "slstatus.h"
+#include "util.h"
+#include "xout.h"
+
+#define XOUT_WATCH_MAX 4
+
+Display *dpy;
+
+static xcb_connection_t *xc;
+static xcb_window_t root;
+static xcb_atom_t net_wm_name, utf8_string;
+static void (*watch[XOUT_WATCH_MAX])(XEvent *);
+static size_t nwatch;
+
+static int
+xout_ioerror(Display *d)
+{
+	die("X connection lost");
+	return 0;
+}
+
+static void
+xout_read(int fd, void *arg)
+{
+	XEvent ev;
+	size_t i;
+
+	/* a dead server ends up in xout_ioerror() */
+	while (XPending(dpy)) {
+		XNextEvent(dpy, &ev);
+		for (i = 0; i < nwatch; i++)
+			watch[i](&ev);
+	}
+}
+
+static xcb_atom_t
+xout_atom(xcb_intern_atom_cookie_t cookie)
+{
+	xcb_intern_atom_reply_t *reply;
+	xcb_atom_t atom = XCB_ATOM_NONE;
+
+	if ((reply = xcb_intern_atom_reply(xc, cookie, NULL))) {
+		atom = reply->atom;
+		free(reply);
+	}
+
+	return atom;
+}
+
+void
+xout_init(void)
+{
+	xcb_intern_atom_cookie_t name, utf8;
+
+	if (!(dpy = XOpenDisplay(NULL)))
+		die("XOpenDisplay: Failed to open display");
+	XSetIOErrorHandler(xout_ioerror);
+
+	xc = XGetXCBConnection(dpy);
+	root = DefaultRootWindow(dpy);
+
+	/* the only round-trip, both requests share it */
+	name = xcb_intern_atom(xc, 0, strlen("_NET_WM_NAME"), "_NET_WM_NAME");
+	utf8 = xcb_intern_atom(xc, 0, strlen("UTF8_STRING"), "UTF8_STRING");
+	net_wm_name = xout_atom(name);
+	utf8_string = xout_atom(utf8);
+
+	loop_add(xcb_get_file_descriptor(xc), xout_read, NULL);
+	/* events Xlib queued while reading replies, e.g. during xkb_init() */
+	loop_drain(xcb_get_file_descriptor(xc));
+}
+
+void
+xout_watch(void (*cb)(XEvent *))
+{
+	if (nwatch == XOUT_WATCH_MAX)
+		die("xout_watch: more than %d callbacks", XOUT_WATCH_MAX);
+	watch[nwatch++] = cb;
+}
+
+/*
+ * whether need bytes fit into the socket buffer; POLLOUT alone does not
+ * keep xcb_flush() from blocking on the rest of a partial write
+ */
+static int
+xout_room(int fd, size_t need)
+{
+	struct pollfd pfd;
+#if defined(FIONSPACE)
+	int space;
+
+	if (!ioctl(fd, FIONSPACE, &space))
+		return space >= 0 && (size_t)space >= need;
+#elif defined(__linux__) && defined(TIOCOUTQ)
+	int queued, size;
+	socklen_t len = sizeof(size);
+
+	if (!ioctl(fd, TIOCOUTQ, &queued) &&
+	    !getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, &len))
+		return size - queued >= 0 && (size_t)(size - queued) >= need;
+#endif
+
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+
+	return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLOUT);
+}
+
+/* 0 if the update was dropped */
+int
+xout_set(const char *status)
+{
+	size_t len = strlen(status);
+
+	/*
+	 * a server not draining its socket gets no backlog from us: both
+	 * ChangeProperty requests (24 bytes and the padded data each) must
+	 * fit, anything Xlib buffered went out with the drain before poll
+	 */
+	if (!xout_room(xcb_get_file_descriptor(xc), 2 * (24 + len + 3)))
+		return 0;
+
+	/* WM_NAME keeps the raw bytes for bars reading it as STRING */
+	xcb_change_property(xc, XCB_PROP_MODE_REPLACE, root, XCB_ATOM_WM_NAME,
+	                    XCB_ATOM_STRING, 8, len, status);
+	if (net_wm_name != XCB_ATOM_NONE && utf8_string != XCB_ATOM_NONE)
+		xcb_change_property(xc, XCB_PROP_MODE_REPLACE, root, net_wm_name,
+		                    utf8_string, 8, len, status);
+
+	if (xcb_flush(xc) <= 0)
+		die("X connection lost");
+
+	return 1;
+}
+
+void
+xout_free(void)
+{
+	if (!dpy)
+		return;
+
+	loop_del(xcb_get_file_descriptor(xc));
+
+	xcb_delete_property(xc, root, XCB_ATOM_WM_NAME);
+	if (net_wm_name != XCB_ATOM_NONE)
+		xcb_delete_property(xc, root, net_wm_name);
+	xcb_flush(xc);
+
+	if (XCloseDisplay(dpy) < 0)
+		die("XCloseDisplay: Failed to close display");
+	dpy = NULL;
+	nwatch = 0;
+}
@@ -0,0 +1,14 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * Status output to the root window name. Properties are written through
+ * the XCB connection underneath Xlib without waiting for replies, the
+ * connection is watched from the main loop and events on it are handed
+ * to the callbacks given to xout_watch().
+ */
+union _XEvent;
+
+void xout_init(void);
+void xout_watch(void (*cb)(union _XEvent *));
+int xout_set(const char *status);
+void xout_free(void);